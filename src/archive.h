@@ -1,15 +1,30 @@
 #pragma once
 
 #include <napi.h>
+#include <sys/stat.h>
 #include <zim/archive.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <exception>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "entry.h"
+#include "entryFilter.h"
+#include "entryListing.h"
+#include "executor.h"
 #include "illustration.h"
+#include "indexPreload.h"
 #include "item.h"
 #include "openconfig.h"
 
@@ -19,6 +34,11 @@ class Archive : public Napi::ObjectWrap<Archive> {
       : Napi::ObjectWrap<Archive>(info), archive_{nullptr} {
     Napi::Env env = info.Env();
 
+    if (info[0].IsExternal()) {
+      archive_ = *info[0].As<Napi::External<decltype(archive_)>>().Data();
+      return;
+    }
+
     if (info.Length() < 1) {
       throw Napi::Error::New(env, "Archive requires arguments filepath");
     }
@@ -31,11 +51,40 @@ class Archive : public Napi::ObjectWrap<Archive> {
     // Archive(filename: string)
     // Archive(filepath: string, config: OpenConfig)
     std::string filepath = info[0].As<Napi::String>();
+    auto config = configFrom(env, info[1]);
+
+    try {
+      archive_ = std::make_shared<zim::Archive>(filepath, config);
+    } catch (const std::exception &e) {
+      throw Napi::Error::New(env, e.what());
+    }
+  }
+
+  // the searchers a preload kept for the archive go with its last owner
+  ~Archive() {
+    std::weak_ptr<zim::Archive> archive = archive_;
+    archive_.reset();
+    if (archive.expired()) {
+      IndexPreload::Purge();
+    }
+  }
+
+  static Napi::Object New(Napi::Env env,
+                          std::shared_ptr<zim::Archive> archive) {
+    auto external = Napi::External<decltype(archive)>::New(env, &archive);
+    auto &constructor = env.GetInstanceData<ModuleConstructors>()->archive;
+    return constructor.New({external});
+  }
+
+  /**
+   * Reads the optional OpenConfig argument given when opening an archive.
+   */
+  static zim::OpenConfig configFrom(Napi::Env env, const Napi::Value &value) {
     zim::OpenConfig config{};
-    if (info[1].IsObject()) {
+    if (value.IsObject()) {
       // @note: no bounds checking on info because it returns Undefined when out
       // of bounds
-      auto obj = info[1].As<Napi::Object>();
+      auto obj = value.As<Napi::Object>();
       // Check that the object is an instance of OpenConfig
       // TODO(kelvinhammond): Update use of Unwrap everywhere to use
       // InstanceOf and GetConstructor pattern
@@ -46,12 +95,7 @@ class Archive : public Napi::ObjectWrap<Archive> {
             env, "Second argument must be an instance of OpenConfig.");
       }
     }
-
-    try {
-      archive_ = std::make_shared<zim::Archive>(filepath, config);
-    } catch (const std::exception &e) {
-      throw Napi::Error::New(env, e.what());
-    }
+    return config;
   }
 
   Napi::Value getFilename(const Napi::CallbackInfo &info) {
@@ -292,6 +336,151 @@ class Archive : public Napi::ObjectWrap<Archive> {
     }
   }
 
+  /**
+   * sampleEntries(n, [{frontArticlesOnly, mimetypes, minSize, seed, fields}])
+   * draws up to n distinct entries as plain records (see listByPathPrefix()
+   * for fields). Front articles are drawn unless frontArticlesOnly is false,
+   * redirects are skipped. A seed gives the same samples for the same
+   * archive and options. Fewer than n come back when the filters reject most
+   * draws.
+   */
+  Napi::Value sampleEntries(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      if (!info[0].IsNumber()) {
+        throw Napi::Error::New(
+            env, "sampleEntries must be called with a count of type Number");
+      }
+      const auto n = static_cast<uint64_t>(
+          std::max<int64_t>(info[0].ToNumber().Int64Value(), 0));
+
+      bool frontArticlesOnly = true;
+      EntryFilter filter;
+      uint64_t seed = std::random_device{}();
+      uint32_t fields = EntryListing::kDefaultFields;
+      if (info[1].IsObject()) {
+        auto options = info[1].As<Napi::Object>();
+        if (options.Has("frontArticlesOnly")) {
+          frontArticlesOnly = options.Get("frontArticlesOnly").ToBoolean();
+        }
+        filter = EntryFilter::From(env, options);
+        if (options.Has("seed")) {
+          seed = options.Get("seed").ToNumber().Int64Value();
+        }
+        fields = EntryListing::FieldsFrom(env, options.Get("fields"));
+      }
+
+      const uint64_t population = frontArticlesOnly
+                                      ? archive_->getArticleCount()
+                                      : archive_->getEntryCount();
+      auto res = Napi::Array::New(env);
+      if (population == 0) {
+        return res;
+      }
+
+      std::mt19937_64 rng(seed);
+      std::uniform_int_distribution<uint64_t> pick(0, population - 1);
+      std::unordered_set<uint64_t> drawn;
+      const uint64_t maxDraws = n * kSampleDrawsPerEntry;
+      uint32_t found = 0;
+      for (uint64_t draws = 0; found < n && draws < maxDraws &&
+                               drawn.size() < population;
+           draws++) {
+        const auto index = pick(rng);
+        if (!drawn.insert(index).second) {
+          continue;
+        }
+        const auto idx = static_cast<zim::entry_index_type>(index);
+        auto entry = frontArticlesOnly ? archive_->getEntryByTitle(idx)
+                                       : archive_->getEntryByPath(idx);
+        if (filter.matches(entry)) {
+          res.Set(found++, EntryListing::ToObject(env, entry, fields));
+        }
+      }
+      return res;
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  /**
+   * scan([{mimetypes, pathRegex, minSize, maxSize, redirects}],
+   *      [{threads, priority, signal, timeoutMs}])
+   * resolves to a Uint32Array of the (path order) indexes of the entries
+   * matching the filter, in cluster order. The cluster order is split into
+   * one contiguous range per thread, so each one reads its clusters
+   * sequentially.
+   */
+  Napi::Value scan(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      auto filter = std::make_shared<EntryFilter>();
+      if (info[0].IsObject()) {
+        *filter = EntryFilter::From(env, info[0].As<Napi::Object>());
+      }
+
+      size_t threads = std::max(1u, std::thread::hardware_concurrency());
+      if (info[1].IsObject()) {
+        auto options = info[1].As<Napi::Object>();
+        if (options.Has("threads")) {
+          const auto value = options.Get("threads").ToNumber().Int64Value();
+          if (value < 1) {
+            throw Napi::Error::New(env, "threads must be at least 1");
+          }
+          threads = static_cast<size_t>(value);
+        }
+      }
+
+      const auto count = archive_->getEntryCount();
+      threads = std::min<size_t>({threads, kMaxScanThreads,
+                                  std::max<size_t>(count / kMinScanRange, 1)});
+      const auto priority = Executor::priorityFrom(
+          env, info[1], Executor::Priority::Background);
+      auto cancellation = Cancellation::From(env, info[1]);
+
+      using Matches = std::vector<uint32_t>;
+      std::vector<std::function<Matches()>> tasks;
+      for (size_t i = 0; i < threads; i++) {
+        const zim::entry_index_type begin = count * i / threads;
+        const zim::entry_index_type end = count * (i + 1) / threads;
+        tasks.push_back([archive = archive_, filter, cancellation, begin,
+                         end]() {
+          Matches matches;
+          for (auto idx = begin; idx < end; idx++) {
+            if (cancellation && (idx - begin) % kScanPollInterval == 0 &&
+                cancellation->expired()) {
+              break;
+            }
+            auto entry = archive->getEntryByClusterOrder(idx);
+            if (filter->matches(entry)) {
+              matches.push_back(entry.getIndex());
+            }
+          }
+          return matches;
+        });
+      }
+
+      return ExecutorBatchWorker<Matches>::Run(
+          env, priority, std::move(tasks),
+          [](Napi::Env env, std::vector<Matches> &results) {
+            size_t total = 0;
+            for (const auto &matches : results) {
+              total += matches.size();
+            }
+            auto res = Napi::Uint32Array::New(env, total);
+            size_t i = 0;
+            for (const auto &matches : results) {
+              std::copy(matches.begin(), matches.end(), res.Data() + i);
+              i += matches.size();
+            }
+            return res;
+          },
+          cancellation);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
   Napi::Value hasEntryByPath(const Napi::CallbackInfo &info) {
     try {
       return Napi::Value::From(info.Env(),
@@ -437,6 +626,30 @@ class Archive : public Napi::ObjectWrap<Archive> {
     }
   }
 
+  /**
+   * listByPathPrefix(prefix, [{start, limit, fields}]) returns
+   * {count, start, entries}: the number of entries under prefix and a page
+   * of plain records (index, path and title by default, limit 100).
+   */
+  Napi::Value listByPathPrefix(const Napi::CallbackInfo &info) {
+    try {
+      auto range = archive_->findByPath(info[0].ToString());
+      return EntryListing::Page(info.Env(), range, info[1]);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  // listByTitlePrefix(prefix, [options]), see listByPathPrefix()
+  Napi::Value listByTitlePrefix(const Napi::CallbackInfo &info) {
+    try {
+      auto range = archive_->findByTitle(info[0].ToString());
+      return EntryListing::Page(info.Env(), range, info[1]);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
   Napi::Value hasChecksum(const Napi::CallbackInfo &info) {
     try {
       return Napi::Value::From(info.Env(), archive_->hasChecksum());
@@ -471,6 +684,55 @@ class Archive : public Napi::ObjectWrap<Archive> {
     }
   }
 
+  // checkAsync([options]) runs in the background lane by default
+  Napi::Value checkAsync(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      auto priority = Executor::priorityFrom(env, info[0],
+                                             Executor::Priority::Background);
+      auto archive = archive_;
+      return ExecutorPromiseWorker<bool>::Run(
+          env, priority, [archive]() { return archive->check(); },
+          [](Napi::Env env, bool &res) { return Napi::Value::From(env, res); });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  // checkIntegrityAsync(checkType, [options]) runs in the background lane by
+  // default
+  Napi::Value checkIntegrityAsync(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      const auto checkType = IntegrityCheck::symbolToEnum(env, info[0]);
+      auto priority = Executor::priorityFrom(env, info[1],
+                                             Executor::Priority::Background);
+      auto archive = archive_;
+      return ExecutorPromiseWorker<bool>::Run(
+          env, priority,
+          [archive, checkType]() { return archive->checkIntegrity(checkType); },
+          [](Napi::Env env, bool &res) { return Napi::Value::From(env, res); });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  /**
+   * preloadFulltextIndex([{async, priority, onProgress, signal, timeoutMs}])
+   * reads the fulltext Xapian database into the page cache and opens it, so
+   * the first search does not pay for a cold index. The next Searcher built
+   * over this archive alone adopts the opened database. With async it runs in
+   * the background lane by default and resolves with the same summary.
+   */
+  Napi::Value preloadFulltextIndex(const Napi::CallbackInfo &info) {
+    return preloadIndex(info, IndexPreload::Kind::Fulltext);
+  }
+
+  // preloadTitleIndex([options]) is preloadFulltextIndex() for the title index
+  Napi::Value preloadTitleIndex(const Napi::CallbackInfo &info) {
+    return preloadIndex(info, IndexPreload::Kind::Title);
+  }
+
   Napi::Value isMultiPart(const Napi::CallbackInfo &info) {
     try {
       return Napi::Value::From(info.Env(), archive_->isMultiPart());
@@ -517,6 +779,53 @@ class Archive : public Napi::ObjectWrap<Archive> {
     }
   }
 
+  /**
+   * fromFd(fd, [{offset, size}], [config]) opens an archive from an already
+   * open file descriptor, optionally one embedded at offset in a larger file.
+   * size defaults to the rest of the file. libzim does not take ownership of
+   * fd, it may be closed once the archive is open.
+   */
+  static Napi::Value fromFd(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    try {
+      if (!info[0].IsNumber()) {
+        throw Napi::TypeError::New(env, "fd must be a number");
+      }
+
+      const int fd = info[0].ToNumber().Int32Value();
+      auto config = configFrom(env, info[2]);
+      if (!info[1].IsObject()) {
+        return New(env, std::make_shared<zim::Archive>(fd, config));
+      }
+
+      auto range = info[1].As<Napi::Object>();
+      zim::offset_type offset = 0;
+      if (range.Has("offset")) {
+        offset = rangeValueFrom(env, range.Get("offset"), "offset");
+      }
+
+      zim::size_type size = 0;
+      if (range.Has("size")) {
+        size = rangeValueFrom(env, range.Get("size"), "size");
+      } else {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+          throw std::runtime_error(std::string("fstat failed: ") +
+                                   std::strerror(errno));
+        }
+        if (offset > static_cast<zim::offset_type>(st.st_size)) {
+          throw Napi::RangeError::New(env, "offset is past the end of file");
+        }
+        size = st.st_size - offset;
+      }
+
+      return New(env, std::make_shared<zim::Archive>(
+                          zim::FdInput(fd, offset, size), config));
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
   static Napi::Value validate(const Napi::CallbackInfo &info) {
     Napi::Env env = info.Env();
     try {
@@ -530,24 +839,40 @@ class Archive : public Napi::ObjectWrap<Archive> {
       }
 
       auto &&zimPath = info[0].ToString();
-      auto symbolList = info[1].As<Napi::Array>();
-      zim::IntegrityCheckList flags{};
-      for (size_t i = 0; i < symbolList.Length(); i++) {
-        const auto bit = IntegrityCheck::symbolToEnum(env, symbolList.Get(i));
-        auto &&isAll = (bit == zim::IntegrityCheck::COUNT ||
-                        static_cast<size_t>(bit) >= flags.size());
-        if (isAll) {  // This handle IntegrityCheck::COUNT
-          flags.set();
-          break;
-        }
-        flags.set(static_cast<size_t>(bit));
-      }
+      auto flags = integrityCheckListFrom(env, info[1].As<Napi::Array>());
       return Napi::Value::From(env, zim::validate(zimPath, flags));
     } catch (const std::exception &err) {
       throw Napi::Error::New(env, err.what());
     }
   }
 
+  // validateAsync(zimPath, checks, [options]) runs in the background lane by
+  // default
+  static Napi::Value validateAsync(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    try {
+      if (info.Length() < 2) {
+        throw Napi::Error::New(
+            env, "validateAsync requires zimPath and [IntegrityCheck, ...]");
+      } else if (!info[0].IsString()) {
+        throw Napi::Error::New(env, "zimPath must be a string");
+      } else if (!info[1].IsArray()) {
+        throw Napi::Error::New(env, "IntegrityCheckList must be an array");
+      }
+
+      std::string zimPath = info[0].ToString();
+      auto flags = integrityCheckListFrom(env, info[1].As<Napi::Array>());
+      auto priority = Executor::priorityFrom(env, info[2],
+                                             Executor::Priority::Background);
+      return ExecutorPromiseWorker<bool>::Run(
+          env, priority,
+          [zimPath, flags]() { return zim::validate(zimPath, flags); },
+          [](Napi::Env env, bool &res) { return Napi::Value::From(env, res); });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
   static void Init(Napi::Env env, Napi::Object exports,
                    ModuleConstructors &constructors) {
     Napi::Function func = DefineClass(
@@ -578,21 +903,31 @@ class Archive : public Napi::ObjectWrap<Archive> {
             InstanceAccessor<&Archive::getMainEntry>("mainEntry"),
             InstanceAccessor<&Archive::getRandomEntry>("randomEntry"),
             InstanceMethod<&Archive::getRandomEntry>("getRandomEntry"),
+            InstanceMethod<&Archive::sampleEntries>("sampleEntries"),
+            InstanceMethod<&Archive::scan>("scan"),
             InstanceMethod<&Archive::hasEntryByPath>("hasEntryByPath"),
             InstanceMethod<&Archive::hasEntryByTitle>("hasEntryByTitle"),
             InstanceMethod<&Archive::hasMainEntry>("hasMainEntry"),
             InstanceMethod<&Archive::hasIllustration>("hasIllustration"),
             InstanceMethod<&Archive::hasFulltextIndex>("hasFulltextIndex"),
             InstanceMethod<&Archive::hasTitleIndex>("hasTitleIndex"),
+            InstanceMethod<&Archive::preloadFulltextIndex>(
+                "preloadFulltextIndex"),
+            InstanceMethod<&Archive::preloadTitleIndex>("preloadTitleIndex"),
             InstanceMethod<&Archive::iterByPath>("iterByPath"),
             InstanceMethod<&Archive::iterByTitle>("iterByTitle"),
             InstanceMethod<&Archive::iterEfficient>("iterEfficient"),
             InstanceMethod<&Archive::findByPath>("findByPath"),
             InstanceMethod<&Archive::findByTitle>("findByTitle"),
+            InstanceMethod<&Archive::listByPathPrefix>("listByPathPrefix"),
+            InstanceMethod<&Archive::listByTitlePrefix>("listByTitlePrefix"),
             InstanceAccessor<&Archive::hasChecksum>("hasChecksum"),
             InstanceAccessor<&Archive::getChecksum>("checksum"),
             InstanceMethod<&Archive::check>("check"),
             InstanceMethod<&Archive::checkIntegrity>("checkIntegrity"),
+            InstanceMethod<&Archive::checkAsync>("checkAsync"),
+            InstanceMethod<&Archive::checkIntegrityAsync>(
+                "checkIntegrityAsync"),
             InstanceMethod<&Archive::getDirentCacheMaxSize>(
                 "getDirentCacheMaxSize"),
             InstanceMethod<&Archive::getDirentCacheCurrentSize>(
@@ -602,7 +937,9 @@ class Archive : public Napi::ObjectWrap<Archive> {
             InstanceAccessor<&Archive::isMultiPart>("isMultiPart"),
             InstanceAccessor<&Archive::hasNewNamespaceScheme>(
                 "hasNewNamespaceScheme"),
+            StaticMethod<&Archive::fromFd>("fromFd"),
             StaticMethod<&Archive::validate>("validate"),
+            StaticMethod<&Archive::validateAsync>("validateAsync"),
         });
 
     exports.Set("Archive", func);
@@ -613,5 +950,98 @@ class Archive : public Napi::ObjectWrap<Archive> {
   std::shared_ptr<zim::Archive> archive() { return archive_; }
 
  private:
+  // draws per requested sample before sampleEntries() gives up
+  static constexpr uint64_t kSampleDrawsPerEntry = 64;
+  // scan() ranges: no more threads than this, none shorter than that
+  static constexpr size_t kMaxScanThreads = 64;
+  static constexpr zim::entry_index_type kMinScanRange = 1024;
+  // entries between two cancellation checks of a scan() range
+  static constexpr zim::entry_index_type kScanPollInterval = 4096;
+
+  Napi::Value preloadIndex(const Napi::CallbackInfo &info,
+                           IndexPreload::Kind kind) {
+    auto env = info.Env();
+    try {
+      const auto options = info[0];
+      auto onProgress = options.IsObject()
+                            ? options.As<Napi::Object>().Get("onProgress")
+                            : env.Undefined();
+      if (!onProgress.IsUndefined() && !onProgress.IsFunction()) {
+        throw Napi::TypeError::New(env, "onProgress must be a function");
+      }
+
+      auto archive = archive_;
+      if (!options.IsObject() ||
+          !options.As<Napi::Object>().Get("async").ToBoolean()) {
+        auto res = IndexPreload::Run(
+            archive, kind,
+            [env, onProgress](const char *phase, uint64_t done,
+                              uint64_t total) {
+              if (onProgress.IsFunction()) {
+                onProgress.As<Napi::Function>().Call(
+                    {IndexPreload::ProgressObject(env, phase, done, total)});
+              }
+            },
+            []() { return false; });
+        return IndexPreload::ToObject(env, res);
+      }
+
+      const auto priority = Executor::priorityFrom(
+          env, options, Executor::Priority::Background);
+      auto cancellation = Cancellation::From(env, options);
+      auto reporter = std::make_shared<IndexPreloadReporter>(env, onProgress);
+      return ExecutorPromiseWorker<IndexPreload::Result>::Run(
+          env, priority,
+          [archive, kind, reporter, cancellation]() {
+            return IndexPreload::Run(
+                archive, kind,
+                [reporter](const char *phase, uint64_t done, uint64_t total) {
+                  reporter->report(phase, done, total);
+                },
+                [cancellation]() {
+                  return cancellation && cancellation->expired();
+                });
+          },
+          [](Napi::Env env, IndexPreload::Result &res) {
+            return IndexPreload::ToObject(env, res);
+          },
+          cancellation);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  // fromFd offset/size, a non-negative Number or BigInt
+  static uint64_t rangeValueFrom(Napi::Env env, const Napi::Value &value,
+                                 const std::string &name) {
+    if (value.IsBigInt()) {
+      return value.As<Napi::BigInt>().Uint64Value(nullptr);
+    } else if (value.IsNumber()) {
+      int64_t val = value.ToNumber().Int64Value();
+      if (val < 0) {
+        throw Napi::Error::New(env,
+                               name + " must be greater than or equal to 0");
+      }
+      return static_cast<uint64_t>(val);
+    }
+    throw Napi::Error::New(env, name + " must be an Number or BigInt");
+  }
+
+  static zim::IntegrityCheckList integrityCheckListFrom(
+      Napi::Env env, const Napi::Array &symbolList) {
+    zim::IntegrityCheckList flags{};
+    for (size_t i = 0; i < symbolList.Length(); i++) {
+      const auto bit = IntegrityCheck::symbolToEnum(env, symbolList.Get(i));
+      auto &&isAll = (bit == zim::IntegrityCheck::COUNT ||
+                      static_cast<size_t>(bit) >= flags.size());
+      if (isAll) {  // This handle IntegrityCheck::COUNT
+        flags.set();
+        break;
+      }
+      flags.set(static_cast<size_t>(bit));
+    }
+    return flags;
+  }
+
   std::shared_ptr<zim::Archive> archive_;
 };
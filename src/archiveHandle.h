@@ -0,0 +1,257 @@
+#pragma once
+
+#include <napi.h>
+#include <zim/archive.h>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "archive.h"
+#include "common.h"
+#include "executor.h"
+#include "indexPreload.h"
+
+/**
+ * Shared, swappable reference to a zim::Archive.
+ *
+ * Searchers built over an ArchiveHandle keep the slot and rebuild themselves
+ * when its generation changes. Readers that already hold the previous
+ * zim::Archive (entries, items, searches, async work) keep it alive through
+ * their own shared_ptr until they are done.
+ */
+class ArchiveSlot {
+ public:
+  explicit ArchiveSlot(std::shared_ptr<zim::Archive> archive)
+      : archive_{std::move(archive)}, generation_{0} {}
+
+  std::shared_ptr<zim::Archive> archive() const {
+    return std::atomic_load(&archive_);
+  }
+
+  uint64_t generation() const { return generation_.load(); }
+
+  void swap(std::shared_ptr<zim::Archive> archive) {
+    std::atomic_store(&archive_, std::move(archive));
+    generation_++;
+  }
+
+ private:
+  std::shared_ptr<zim::Archive> archive_;
+  std::atomic<uint64_t> generation_;
+};
+
+/**
+ * The slots a searcher is built over, with the generation each one had when
+ * the searcher was (re)built.
+ */
+class ArchiveSet {
+ public:
+  void add(std::shared_ptr<ArchiveSlot> slot) {
+    generations_.push_back(slot->generation());
+    slots_.push_back(std::move(slot));
+  }
+
+  // true when any slot has been swapped since the last snapshot()
+  bool stale() const {
+    for (size_t i = 0; i < slots_.size(); i++) {
+      if (slots_[i]->generation() != generations_[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<zim::Archive> snapshot() {
+    std::vector<zim::Archive> archives;
+    for (size_t i = 0; i < slots_.size(); i++) {
+      // read the generation first, a swap racing with us is picked up on the
+      // next stale() check
+      generations_[i] = slots_[i]->generation();
+      archives.emplace_back(*slots_[i]->archive());
+    }
+    return archives;
+  }
+
+  const std::vector<std::shared_ptr<ArchiveSlot>> &slots() const {
+    return slots_;
+  }
+
+ private:
+  std::vector<std::shared_ptr<ArchiveSlot>> slots_;
+  std::vector<uint64_t> generations_;
+};
+
+class ArchiveHandle : public Napi::ObjectWrap<ArchiveHandle> {
+ public:
+  explicit ArchiveHandle(const Napi::CallbackInfo &info)
+      : Napi::ObjectWrap<ArchiveHandle>(info), slot_{nullptr} {
+    Napi::Env env = info.Env();
+
+    if (!info[0].IsString()) {
+      throw Napi::TypeError::New(env,
+                                 "First argument must be a string filepath.");
+    }
+
+    // ArchiveHandle(filepath: string, [config: OpenConfig])
+    std::string filepath = info[0].As<Napi::String>();
+    auto config = Archive::configFrom(env, info[1]);
+
+    try {
+      slot_ = std::make_shared<ArchiveSlot>(
+          std::make_shared<zim::Archive>(filepath, config));
+    } catch (const std::exception &e) {
+      throw Napi::Error::New(env, e.what());
+    }
+  }
+
+  Napi::Value getArchive(const Napi::CallbackInfo &info) {
+    try {
+      return Archive::New(info.Env(), slot_->archive());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  Napi::Value getFilename(const Napi::CallbackInfo &info) {
+    try {
+      return Napi::Value::From(info.Env(), slot_->archive()->getFilename());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  Napi::Value getGeneration(const Napi::CallbackInfo &info) {
+    try {
+      return Napi::Value::From(info.Env(), slot_->generation());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * swap(filepath, [config]) opens and warms the new archive in the
+   * background lane, preloading its indexes like preloadIndex(), then
+   * switches the handle over to it and resolves with the new Archive.
+   */
+  Napi::Value swap(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      if (!info[0].IsString()) {
+        throw Napi::TypeError::New(
+            env, "First argument must be a string filepath.");
+      }
+
+      std::string filepath = info[0].As<Napi::String>();
+      auto config = Archive::configFrom(env, info[1]);
+      auto slot = slot_;
+      return ExecutorPromiseWorker<std::shared_ptr<zim::Archive>>::Run(
+          env, Executor::Priority::Background,
+          [filepath, config]() {
+            auto archive = std::make_shared<zim::Archive>(filepath, config);
+            warm(archive);
+            return archive;
+          },
+          [slot](Napi::Env env, std::shared_ptr<zim::Archive> &archive) {
+            slot->swap(archive);
+            return Archive::New(env, archive);
+          });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  static Napi::FunctionReference &GetConstructor(Napi::Env env) {
+    return env.GetInstanceData<ModuleConstructors>()->archiveHandle;
+  }
+
+  static bool InstanceOf(Napi::Env env, Napi::Value value) {
+    if (!value.IsObject()) {
+      return false;
+    }
+    Napi::Object obj = value.As<Napi::Object>();
+    Napi::FunctionReference &constructor = GetConstructor(env);
+    return obj.InstanceOf(constructor.Value());
+  }
+
+  /**
+   * Slot for an Archive or ArchiveHandle object. Plain archives get a slot of
+   * their own which is never swapped.
+   */
+  static std::shared_ptr<ArchiveSlot> slotFrom(Napi::Env env,
+                                               const Napi::Object &obj) {
+    if (InstanceOf(env, obj)) {
+      return Unwrap(obj)->slot();
+    }
+    return std::make_shared<ArchiveSlot>(
+        Napi::ObjectWrap<Archive>::Unwrap(obj)->archive());
+  }
+
+  /**
+   * Archives given to a searcher, either a single Archive / ArchiveHandle or
+   * a non empty array of them. name prefixes the error messages.
+   */
+  static ArchiveSet archiveSetFrom(Napi::Env env, const Napi::Value &value,
+                                   const std::string &name) {
+    ArchiveSet set;
+    if (value.IsArray()) {
+      auto array = value.As<Napi::Array>();
+      if (array.Length() < 1) {
+        throw Napi::Error::New(
+            env, name + ": argument array must contain at least 1 archive.");
+      }
+
+      for (size_t i = 0; i < array.Length(); i++) {
+        auto obj = array.Get(i);
+        if (!obj.IsObject()) {
+          throw Napi::Error::New(
+              env, name + ": array arguments must be Archive objects");
+        }
+        set.add(slotFrom(env, obj.As<Napi::Object>()));
+      }
+    } else if (value.IsObject()) {  // one archive
+      set.add(slotFrom(env, value.As<Napi::Object>()));
+    } else {
+      throw Napi::Error::New(env, name +
+                                      ": argument 1 must be an Archive object "
+                                      "or an array of Archive objects.");
+    }
+    return set;
+  }
+
+  static void Init(Napi::Env env, Napi::Object exports,
+                   ModuleConstructors &constructors) {
+    Napi::Function func = DefineClass(
+        env, "ArchiveHandle",
+        {
+            InstanceAccessor<&ArchiveHandle::getArchive>("archive"),
+            InstanceAccessor<&ArchiveHandle::getFilename>("filename"),
+            InstanceAccessor<&ArchiveHandle::getGeneration>("generation"),
+            InstanceMethod<&ArchiveHandle::swap>("swap"),
+        });
+
+    exports.Set("ArchiveHandle", func);
+    constructors.archiveHandle = Napi::Persistent(func);
+  }
+
+  // internal module methods
+  std::shared_ptr<ArchiveSlot> slot() { return slot_; }
+
+ private:
+  // reads the main page and preloads the indexes, as preloadIndex() does, so
+  // that the first lookups and searches after the swap don't hit a cold file
+  static void warm(const std::shared_ptr<zim::Archive> &archive) {
+    if (archive->hasMainEntry()) {
+      archive->getMainEntry().getItem(true).getData();
+    }
+    const auto quiet = [](const char *, uint64_t, uint64_t) {};
+    const auto never = []() { return false; };
+    IndexPreload::Run(archive, IndexPreload::Kind::Fulltext, quiet, never);
+    IndexPreload::Run(archive, IndexPreload::Kind::Title, quiet, never);
+  }
+
+  std::shared_ptr<ArchiveSlot> slot_;
+};
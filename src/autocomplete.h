@@ -0,0 +1,662 @@
+#pragma once
+
+#include <fcntl.h>
+#include <napi.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zim/archive.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "archive.h"
+#include "archiveHandle.h"
+#include "common.h"
+#include "executor.h"
+
+/**
+ * Immutable top-k autocomplete table: for every title prefix of 1 to
+ * maxPrefixLength characters, the best topK entries starting with it.
+ *
+ * Prefixes are ASCII lowercased and counted in UTF-8 code points. The table
+ * is a single buffer with the same layout in memory and in the sidecar file,
+ * so a loaded sidecar is used straight from its mapping:
+ *
+ *   Header | Node[nodeCount] (sorted by key) | keys | uint32 entries
+ */
+class AutocompleteData {
+ public:
+  struct Options {
+    uint32_t topK = 10;
+    uint32_t maxPrefixLength = 3;
+    std::string popularityFile;
+  };
+
+  AutocompleteData(const AutocompleteData &) = delete;
+  AutocompleteData &operator=(const AutocompleteData &) = delete;
+
+  ~AutocompleteData() {
+    if (map_ != nullptr) {
+      ::munmap(map_, size_);
+    }
+  }
+
+  /**
+   * Walks the archive in title order. Entries are ranked by popularity (a
+   * "path<TAB>score" file, missing paths score 0), then by shorter title.
+   */
+  static std::shared_ptr<AutocompleteData> Build(const zim::Archive &archive,
+                                                 const Options &options) {
+    const auto popularity = readPopularity(options.popularityFile);
+    std::unordered_map<std::string, std::vector<Candidate>> nodes;
+
+    for (const auto &entry : archive.iterByTitle()) {
+      const auto title = entry.getTitle();
+      Candidate candidate{0, static_cast<uint32_t>(title.size()),
+                          entry.getIndex()};
+      if (!popularity.empty()) {
+        auto it = popularity.find(entry.getPath());
+        if (it != popularity.end()) {
+          candidate.score = it->second;
+        }
+      }
+
+      const auto key = normalize(title);
+      size_t end = 0;
+      for (uint32_t n = 0; n < options.maxPrefixLength && end < key.size();
+           n++) {
+        end = nextCodePoint(key, end);
+        addCandidate(nodes[key.substr(0, end)], candidate, options.topK);
+      }
+    }
+
+    std::vector<std::string> keys;
+    keys.reserve(nodes.size());
+    for (const auto &node : nodes) {
+      keys.push_back(node.first);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.topK = options.topK;
+    header.maxPrefixLength = options.maxPrefixLength;
+    header.nodeCount = keys.size();
+    std::memcpy(header.uuid, archive.getUuid().data, sizeof(header.uuid));
+
+    std::string keyBlob;
+    std::vector<uint32_t> entries;
+    std::vector<Node> table;
+    for (const auto &key : keys) {
+      auto &candidates = nodes[key];
+      std::sort(candidates.begin(), candidates.end(), better);
+      table.push_back(Node{static_cast<uint32_t>(keyBlob.size()),
+                           static_cast<uint32_t>(key.size()),
+                           static_cast<uint32_t>(entries.size()),
+                           static_cast<uint32_t>(candidates.size())});
+      keyBlob += key;
+      for (const auto &candidate : candidates) {
+        entries.push_back(candidate.entryIndex);
+      }
+    }
+    header.keysBytes = keyBlob.size();
+    header.entryCount = entries.size();
+
+    auto res = std::shared_ptr<AutocompleteData>(new AutocompleteData());
+    auto &buffer = res->buffer_;
+    append(buffer, &header, sizeof(header));
+    append(buffer, table.data(), table.size() * sizeof(Node));
+    append(buffer, keyBlob.data(), keyBlob.size());
+    // keep the entries 4 bytes aligned
+    buffer.resize((buffer.size() + 3) & ~size_t{3});
+    append(buffer, entries.data(), entries.size() * sizeof(uint32_t));
+    res->attach(buffer.data(), buffer.size());
+    return res;
+  }
+
+  /**
+   * Maps a sidecar written by save(). It must have been built from the
+   * archive with this uuid.
+   */
+  static std::shared_ptr<AutocompleteData> Load(const std::string &path,
+                                                const zim::Uuid &uuid) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Cannot open " + path + ": " +
+                               std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(Header)) {
+      ::close(fd);
+      throw std::runtime_error(path + " is not an autocomplete index");
+    }
+
+    const size_t size = st.st_size;
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+      throw std::runtime_error("Cannot map " + path + ": " +
+                               std::strerror(errno));
+    }
+
+    auto res = std::shared_ptr<AutocompleteData>(new AutocompleteData());
+    res->map_ = map;
+    res->size_ = size;
+    res->attach(static_cast<const char *>(map), size);
+    if (std::memcmp(res->header().uuid, uuid.data, sizeof(uuid.data)) != 0) {
+      throw std::runtime_error(path + " was built for another archive");
+    }
+    return res;
+  }
+
+  void save(const std::string &path) const {
+    const auto tmp = path + ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(data_, size_);
+      if (!out) {
+        throw std::runtime_error("Cannot write " + tmp);
+      }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+      throw std::runtime_error("Cannot rename " + tmp + ": " +
+                               std::strerror(errno));
+    }
+  }
+
+  /**
+   * Entry indexes (path order) of the best entries for prefix, empty when
+   * prefix is empty, unknown or longer than maxPrefixLength.
+   */
+  std::vector<uint32_t> lookup(const std::string &prefix, size_t max) const {
+    const auto key = normalize(prefix);
+    const auto nodes = this->nodes();
+    const auto count = header().nodeCount;
+    auto it = std::lower_bound(nodes, nodes + count, key,
+                               [this](const Node &node, std::string_view k) {
+                                 return keyOf(node) < k;
+                               });
+    if (it == nodes + count || keyOf(*it) != key) {
+      return {};
+    }
+    const auto first = entries() + it->entriesOffset;
+    return std::vector<uint32_t>(first,
+                                 first + std::min<size_t>(it->entryCount, max));
+  }
+
+  // the first maxPrefixLength characters of prefix
+  std::string head(const std::string &prefix) const {
+    size_t end = 0;
+    for (uint32_t n = 0; n < header().maxPrefixLength && end < prefix.size();
+         n++) {
+      end = nextCodePoint(prefix, end);
+    }
+    return prefix.substr(0, end);
+  }
+
+  // true when prefix has more characters than the table indexes
+  bool tooLong(const std::string &prefix) const {
+    return head(prefix).size() < prefix.size();
+  }
+
+  // title starts with prefix, ASCII case insensitively like the table
+  static bool startsWith(const std::string &title, const std::string &prefix) {
+    return title.size() >= prefix.size() &&
+           normalize(title.substr(0, prefix.size())) == normalize(prefix);
+  }
+
+  uint32_t topK() const { return header().topK; }
+  uint32_t maxPrefixLength() const { return header().maxPrefixLength; }
+  uint32_t nodeCount() const { return header().nodeCount; }
+  size_t bytes() const { return size_; }
+  bool mapped() const { return map_ != nullptr; }
+
+ private:
+  static constexpr char kMagic[8] = {'Z', 'I', 'M', 'A', 'C', 'P', 'L', 'T'};
+  static constexpr uint32_t kVersion = 1;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t topK;
+    uint32_t maxPrefixLength;
+    uint32_t nodeCount;
+    uint64_t keysBytes;
+    uint64_t entryCount;
+    char uuid[16];
+  };
+
+  struct Node {
+    uint32_t keyOffset;
+    uint32_t keyLength;
+    uint32_t entriesOffset;
+    uint32_t entryCount;
+  };
+
+  struct Candidate {
+    double score;
+    uint32_t titleLength;
+    uint32_t entryIndex;
+  };
+
+  AutocompleteData() : data_{nullptr}, size_{0}, map_{nullptr} {}
+
+  static bool better(const Candidate &a, const Candidate &b) {
+    if (a.score != b.score) return a.score > b.score;
+    if (a.titleLength != b.titleLength) return a.titleLength < b.titleLength;
+    return a.entryIndex < b.entryIndex;
+  }
+
+  // keeps the topK best candidates as a heap with the worst one on top
+  static void addCandidate(std::vector<Candidate> &heap,
+                           const Candidate &candidate, size_t topK) {
+    if (heap.size() < topK) {
+      heap.push_back(candidate);
+      std::push_heap(heap.begin(), heap.end(), better);
+    } else if (topK > 0 && better(candidate, heap.front())) {
+      std::pop_heap(heap.begin(), heap.end(), better);
+      heap.back() = candidate;
+      std::push_heap(heap.begin(), heap.end(), better);
+    }
+  }
+
+  static std::unordered_map<std::string, double> readPopularity(
+      const std::string &path) {
+    std::unordered_map<std::string, double> res;
+    if (path.empty()) {
+      return res;
+    }
+    std::ifstream in(path);
+    if (!in) {
+      throw std::runtime_error("Cannot open popularity file " + path);
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      const auto tab = line.rfind('\t');
+      if (tab == std::string::npos) {
+        continue;
+      }
+      res[line.substr(0, tab)] = std::strtod(line.c_str() + tab + 1, nullptr);
+    }
+    return res;
+  }
+
+  static std::string normalize(const std::string &text) {
+    std::string res = text;
+    for (auto &c : res) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return res;
+  }
+
+  static size_t nextCodePoint(const std::string &text, size_t pos) {
+    pos++;
+    while (pos < text.size() &&
+           (static_cast<uint8_t>(text[pos]) & 0xC0) == 0x80) {
+      pos++;
+    }
+    return pos;
+  }
+
+  static void append(std::vector<char> &buffer, const void *data,
+                     size_t size) {
+    const auto bytes = static_cast<const char *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  }
+
+  /**
+   * Checks the layout and points data_ at it. A sidecar is used straight
+   * from its mapping, so every offset the lookups follow is checked here:
+   * the sections against the size (each term against what is left, the
+   * header fields come from the file and could overflow a sum), then each
+   * node's key and entries against their section, and the key order the
+   * binary search relies on.
+   */
+  void attach(const char *data, size_t size) {
+    data_ = data;
+    size_ = size;
+    if (size < sizeof(Header)) {
+      throw std::runtime_error("Truncated autocomplete index");
+    }
+    const auto &h = header();
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 ||
+        h.version != kVersion) {
+      throw std::runtime_error("Not an autocomplete index");
+    }
+    const uint64_t nodesBytes = uint64_t{h.nodeCount} * sizeof(Node);
+    const uint64_t left = size - sizeof(Header);
+    if (nodesBytes > left || h.keysBytes > left - nodesBytes ||
+        entriesStart() > size ||
+        h.entryCount > (size - entriesStart()) / sizeof(uint32_t)) {
+      throw std::runtime_error("Truncated autocomplete index");
+    }
+
+    const auto nodes = this->nodes();
+    for (uint32_t i = 0; i < h.nodeCount; i++) {
+      const auto &node = nodes[i];
+      if (node.keyOffset > h.keysBytes ||
+          node.keyLength > h.keysBytes - node.keyOffset ||
+          node.entriesOffset > h.entryCount ||
+          node.entryCount > h.entryCount - node.entriesOffset ||
+          (i > 0 && keyOf(nodes[i - 1]) >= keyOf(node))) {
+        throw std::runtime_error("Corrupt autocomplete index");
+      }
+    }
+  }
+
+  const Header &header() const {
+    return *reinterpret_cast<const Header *>(data_);
+  }
+
+  const Node *nodes() const {
+    return reinterpret_cast<const Node *>(data_ + sizeof(Header));
+  }
+
+  size_t entriesStart() const {
+    const auto &h = header();
+    const size_t keysEnd =
+        sizeof(Header) + size_t{h.nodeCount} * sizeof(Node) + h.keysBytes;
+    return (keysEnd + 3) & ~size_t{3};
+  }
+
+  const uint32_t *entries() const {
+    return reinterpret_cast<const uint32_t *>(data_ + entriesStart());
+  }
+
+  std::string_view keyOf(const Node &node) const {
+    const auto keys = data_ + sizeof(Header) +
+                      size_t{header().nodeCount} * sizeof(Node);
+    return std::string_view(keys + node.keyOffset, node.keyLength);
+  }
+
+  std::vector<char> buffer_;
+  const char *data_;
+  size_t size_;
+  void *map_;
+};
+
+/**
+ * Autocomplete over an archive's titles, see AutocompleteData. complete()
+ * reads the table and the K dirents of the answer; prefixes longer than the
+ * table's also walk the archive's title order, see complete().
+ */
+class AutocompleteIndex : public Napi::ObjectWrap<AutocompleteIndex> {
+ public:
+  static constexpr uint32_t kMaxTopK = 1000;
+  static constexpr uint32_t kMaxPrefixLength = 16;
+
+  explicit AutocompleteIndex(const Napi::CallbackInfo &info)
+      : Napi::ObjectWrap<AutocompleteIndex>(info),
+        archive_{nullptr},
+        data_{nullptr} {
+    if (!info[0].IsExternal()) {
+      throw Napi::Error::New(
+          info.Env(),
+          "AutocompleteIndex must be created with build() or load().");
+    }
+    auto &state = *info[0].As<Napi::External<State>>().Data();
+    archive_ = state.first;
+    data_ = state.second;
+  }
+
+  static Napi::Object New(Napi::Env env, std::shared_ptr<zim::Archive> archive,
+                          std::shared_ptr<AutocompleteData> data) {
+    State state{std::move(archive), std::move(data)};
+    auto external = Napi::External<State>::New(env, &state);
+    auto &constructor =
+        env.GetInstanceData<ModuleConstructors>()->autocompleteIndex;
+    return constructor.New({external});
+  }
+
+  /**
+   * build(archive, [{topK, maxPrefixLength, popularityFile, priority}])
+   * walks the titles in the background lane and resolves with the index.
+   */
+  static Napi::Value build(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      auto archive = archiveFrom(env, info[0]);
+      AutocompleteData::Options options;
+      if (info[1].IsObject()) {
+        auto obj = info[1].As<Napi::Object>();
+        if (obj.Has("topK")) {
+          options.topK = boundedFrom(env, obj.Get("topK"), "topK", kMaxTopK);
+        }
+        if (obj.Has("maxPrefixLength")) {
+          options.maxPrefixLength =
+              boundedFrom(env, obj.Get("maxPrefixLength"), "maxPrefixLength",
+                          kMaxPrefixLength);
+        }
+        if (obj.Has("popularityFile")) {
+          options.popularityFile =
+              obj.Get("popularityFile").ToString().Utf8Value();
+        }
+      }
+      const auto priority = Executor::priorityFrom(
+          env, info[1], Executor::Priority::Background);
+
+      return ExecutorPromiseWorker<std::shared_ptr<AutocompleteData>>::Run(
+          env, priority,
+          [archive, options]() {
+            return AutocompleteData::Build(*archive, options);
+          },
+          [archive](Napi::Env env, std::shared_ptr<AutocompleteData> &data) {
+            return New(env, archive, data);
+          });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  // load(archive, path) maps a sidecar written by save()
+  static Napi::Value load(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      auto archive = archiveFrom(env, info[0]);
+      if (!info[1].IsString()) {
+        throw Napi::TypeError::New(env, "path must be a string");
+      }
+      const std::string path = info[1].ToString();
+      return New(env, archive,
+                 AutocompleteData::Load(path, archive->getUuid()));
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  // save(path) writes the sidecar in the background lane
+  Napi::Value save(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      if (!info[0].IsString()) {
+        throw Napi::TypeError::New(env, "path must be a string");
+      }
+      const std::string path = info[0].ToString();
+      auto data = data_;
+      return ExecutorPromiseWorker<bool>::Run(
+          env, Executor::Priority::Background,
+          [data, path]() {
+            data->save(path);
+            return true;
+          },
+          [](Napi::Env env, bool &) { return env.Undefined(); });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  /**
+   * complete(prefix, [{max}]) returns [{title, path, index}], best first.
+   * Prefixes longer than maxPrefixLength fall back to the table's entries
+   * for their first maxPrefixLength characters that go on with the rest of
+   * the prefix, then to the archive's title order. That one is case
+   * sensitive, it is walked for the prefix as given, lowercased, capitalized
+   * and in title case; other casings are only found through the table.
+   */
+  Napi::Value complete(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      if (!info[0].IsString()) {
+        throw Napi::TypeError::New(env, "prefix must be a string");
+      }
+      const std::string prefix = info[0].ToString();
+      size_t max = data_->topK();
+      if (info[1].IsObject() && info[1].As<Napi::Object>().Has("max")) {
+        const auto value =
+            info[1].As<Napi::Object>().Get("max").ToNumber().Int64Value();
+        max = static_cast<size_t>(std::max<int64_t>(value, 0));
+      }
+
+      auto res = Napi::Array::New(env);
+      uint32_t i = 0;
+      auto add = [&](const zim::Entry &entry) {
+        auto obj = Napi::Object::New(env);
+        obj["title"] = entry.getTitle();
+        obj["path"] = entry.getPath();
+        obj["index"] = Napi::Value::From(env, entry.getIndex());
+        res.Set(i++, obj);
+      };
+
+      if (data_->tooLong(prefix)) {
+        std::unordered_set<zim::entry_index_type> seen;
+        auto addMatch = [&](const zim::Entry &entry) {
+          if (AutocompleteData::startsWith(entry.getTitle(), prefix) &&
+              seen.insert(entry.getIndex()).second) {
+            add(entry);
+          }
+        };
+        for (auto index : data_->lookup(data_->head(prefix), data_->topK())) {
+          if (i >= max) break;
+          addMatch(archive_->getEntryByPath(index));
+        }
+        for (const auto &casing : casingsOf(prefix)) {
+          for (const auto &entry : archive_->findByTitle(casing)) {
+            if (i >= max) break;
+            addMatch(entry);
+          }
+        }
+        return res;
+      }
+      for (auto index : data_->lookup(prefix, max)) {
+        add(archive_->getEntryByPath(index));
+      }
+      return res;
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  Napi::Value getTopK(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), data_->topK());
+  }
+
+  Napi::Value getMaxPrefixLength(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), data_->maxPrefixLength());
+  }
+
+  Napi::Value getNodeCount(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), data_->nodeCount());
+  }
+
+  Napi::Value getMemoryBytes(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), data_->bytes());
+  }
+
+  Napi::Value getMapped(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), data_->mapped());
+  }
+
+  static void Init(Napi::Env env, Napi::Object exports,
+                   ModuleConstructors &constructors) {
+    Napi::Function func = DefineClass(
+        env, "AutocompleteIndex",
+        {
+            InstanceMethod<&AutocompleteIndex::complete>("complete"),
+            InstanceMethod<&AutocompleteIndex::save>("save"),
+            InstanceAccessor<&AutocompleteIndex::getTopK>("topK"),
+            InstanceAccessor<&AutocompleteIndex::getMaxPrefixLength>(
+                "maxPrefixLength"),
+            InstanceAccessor<&AutocompleteIndex::getNodeCount>("nodeCount"),
+            InstanceAccessor<&AutocompleteIndex::getMemoryBytes>(
+                "memoryBytes"),
+            InstanceAccessor<&AutocompleteIndex::getMapped>("mapped"),
+            StaticMethod<&AutocompleteIndex::build>("build"),
+            StaticMethod<&AutocompleteIndex::load>("load"),
+        });
+
+    exports.Set("AutocompleteIndex", func);
+    constructors.autocompleteIndex = Napi::Persistent(func);
+  }
+
+ private:
+  using State = std::pair<std::shared_ptr<zim::Archive>,
+                          std::shared_ptr<AutocompleteData>>;
+
+  // an Archive, or the current archive of an ArchiveHandle
+  static std::shared_ptr<zim::Archive> archiveFrom(Napi::Env env,
+                                                   const Napi::Value &value) {
+    if (!value.IsObject()) {
+      throw Napi::TypeError::New(env, "archive must be an Archive object");
+    }
+    return ArchiveHandle::slotFrom(env, value.As<Napi::Object>())->archive();
+  }
+
+  // prefix as given, lowercased, capitalized and in title case (ASCII)
+  static std::vector<std::string> casingsOf(const std::string &prefix) {
+    std::string lower = prefix;
+    for (auto &c : lower) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    std::string capitalized = lower;
+    std::string titled = lower;
+    capitalized[0] = static_cast<char>(
+        std::toupper(static_cast<unsigned char>(capitalized[0])));
+    for (size_t i = 0; i < titled.size(); i++) {
+      if (i == 0 || titled[i - 1] == ' ') {
+        titled[i] = static_cast<char>(
+            std::toupper(static_cast<unsigned char>(titled[i])));
+      }
+    }
+
+    std::vector<std::string> res;
+    for (auto &casing : {prefix, lower, capitalized, titled}) {
+      if (std::find(res.begin(), res.end(), casing) == res.end()) {
+        res.push_back(casing);
+      }
+    }
+    return res;
+  }
+
+  static uint32_t boundedFrom(Napi::Env env, const Napi::Value &value,
+                              const std::string &name, uint32_t max) {
+    if (!value.IsNumber()) {
+      throw Napi::TypeError::New(env, name + " must be a number");
+    }
+    const auto res = value.ToNumber().Int64Value();
+    if (res < 1 || res > max) {
+      throw Napi::RangeError::New(
+          env, name + " must be between 1 and " + std::to_string(max));
+    }
+    return static_cast<uint32_t>(res);
+  }
+
+  std::shared_ptr<zim::Archive> archive_;
+  std::shared_ptr<AutocompleteData> data_;
+};
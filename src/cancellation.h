@@ -0,0 +1,197 @@
+#pragma once
+
+#include <napi.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+/**
+ * Deadline ({timeoutMs}) and AbortSignal ({signal}) of an async call.
+ *
+ * libzim does not expose Xapian's time limit, so a query already running
+ * inside Xapian cannot be interrupted. Instead the promise is rejected as soon
+ * as the deadline passes or the signal aborts, and work which has not started
+ * yet is skipped, so queued work for a dead request does not hold an executor
+ * thread.
+ *
+ * Everything but expired() must be called on the main thread.
+ */
+class Cancellation : public std::enable_shared_from_this<Cancellation> {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Reads {signal, timeoutMs} from an options object, returns nullptr when
+   * neither is set.
+   */
+  static std::shared_ptr<Cancellation> From(Napi::Env env,
+                                            const Napi::Value &options) {
+    if (!options.IsObject()) {
+      return nullptr;
+    }
+
+    auto obj = options.As<Napi::Object>();
+    auto signal = obj.Get("signal");
+    auto timeout = obj.Get("timeoutMs");
+    if (signal.IsUndefined() && timeout.IsUndefined()) {
+      return nullptr;
+    }
+
+    auto res = std::make_shared<Cancellation>();
+    if (!timeout.IsUndefined()) {
+      if (!timeout.IsNumber() || timeout.ToNumber().DoubleValue() < 0) {
+        throw Napi::TypeError::New(env,
+                                   "timeoutMs must be a non-negative number");
+      }
+      res->timeoutMs_ = timeout.ToNumber().Int64Value();
+      res->deadline_ =
+          Clock::now() + std::chrono::milliseconds(res->timeoutMs_);
+      res->hasDeadline_ = true;
+    }
+    if (!signal.IsUndefined()) {
+      if (!signal.IsObject() ||
+          !signal.As<Napi::Object>().Get("addEventListener").IsFunction()) {
+        throw Napi::TypeError::New(env, "signal must be an AbortSignal");
+      }
+      res->signal_ = Napi::Persistent(signal.As<Napi::Object>());
+    }
+    return res;
+  }
+
+  Cancellation()
+      : hasDeadline_{false}, timeoutMs_{0}, aborted_{false}, settled_{false} {}
+
+  // true once the deadline has passed or the signal has aborted
+  bool expired() const {
+    return aborted_.load() || (hasDeadline_ && Clock::now() >= deadline_);
+  }
+
+  /**
+   * Starts watching the deadline and the signal, rejecting deferred with the
+   * matching error when one of them fires first.
+   */
+  void arm(Napi::Env env, Napi::Promise::Deferred deferred) {
+    deferred_ = std::make_unique<Napi::Promise::Deferred>(deferred);
+    auto self = shared_from_this();
+
+    if (!signal_.IsEmpty()) {
+      auto signal = signal_.Value();
+      if (signal.Get("aborted").ToBoolean()) {
+        aborted_ = true;
+        reject(env);
+        return;
+      }
+
+      auto onAbort = Napi::Function::New(
+          env, [self](const Napi::CallbackInfo &info) {
+            self->aborted_ = true;
+            self->reject(info.Env());
+          });
+      onAbort_ = Napi::Persistent(onAbort);
+      signal.Get("addEventListener")
+          .As<Napi::Function>()
+          .Call(signal, {Napi::String::New(env, "abort"), onAbort});
+    }
+
+    if (hasDeadline_) {
+      auto onTimeout = Napi::Function::New(
+          env, [self](const Napi::CallbackInfo &info) {
+            self->reject(info.Env());
+          });
+      auto timer = env.Global().Get("setTimeout").As<Napi::Function>().Call(
+          {onTimeout, Napi::Number::New(env, timeoutMs_)});
+      timer_ = Napi::Persistent(timer.As<Napi::Object>());
+    }
+  }
+
+  /**
+   * For results ready without any work, e.g. from a cache: rejects deferred
+   * and returns true when the signal has already aborted or the deadline has
+   * passed, without arming anything.
+   */
+  bool rejectIfExpired(Napi::Env env, Napi::Promise::Deferred deferred) {
+    if (!signal_.IsEmpty() && signal_.Value().Get("aborted").ToBoolean()) {
+      aborted_ = true;
+    }
+    if (!expired()) {
+      return false;
+    }
+    settled_ = true;
+    deferred.Reject(error(env));
+    return true;
+  }
+
+  // rejects the promise unless it is already settled
+  void reject(Napi::Env env) {
+    if (settled_) {
+      return;
+    }
+    settled_ = true;
+    disarm(env);
+    deferred_->Reject(error(env));
+  }
+
+  /**
+   * Called when the work completed. Returns false when the promise was
+   * already rejected because of the deadline or the signal.
+   */
+  bool finish(Napi::Env env) {
+    if (settled_) {
+      return false;
+    }
+    settled_ = true;
+    disarm(env);
+    return true;
+  }
+
+  // the signal's reason when aborted, a TimeoutError otherwise
+  Napi::Value error(Napi::Env env) const {
+    if (aborted_) {
+      auto reason = signal_.IsEmpty() ? env.Undefined()
+                                      : signal_.Value().Get("reason");
+      if (!reason.IsUndefined()) {
+        return reason;
+      }
+      auto err = Napi::Error::New(env, "The operation was aborted");
+      err.Set("name", Napi::String::New(env, "AbortError"));
+      err.Set("code", Napi::String::New(env, "ABORT_ERR"));
+      return err.Value();
+    }
+
+    auto err = Napi::Error::New(
+        env, "Operation timed out after " + std::to_string(timeoutMs_) + "ms");
+    err.Set("name", Napi::String::New(env, "TimeoutError"));
+    err.Set("code", Napi::String::New(env, "ETIMEDOUT"));
+    return err.Value();
+  }
+
+ private:
+  // drops the timer and the listener, which also releases their reference to
+  // this object
+  void disarm(Napi::Env env) {
+    if (!timer_.IsEmpty()) {
+      env.Global().Get("clearTimeout").As<Napi::Function>().Call(
+          {timer_.Value()});
+      timer_.Reset();
+    }
+    if (!onAbort_.IsEmpty()) {
+      auto signal = signal_.Value();
+      signal.Get("removeEventListener")
+          .As<Napi::Function>()
+          .Call(signal, {Napi::String::New(env, "abort"), onAbort_.Value()});
+      onAbort_.Reset();
+    }
+  }
+
+  bool hasDeadline_;
+  int64_t timeoutMs_;
+  Clock::time_point deadline_;
+  std::atomic<bool> aborted_;
+  bool settled_;
+  std::unique_ptr<Napi::Promise::Deferred> deferred_;
+  Napi::ObjectReference signal_;
+  Napi::FunctionReference onAbort_;
+  Napi::ObjectReference timer_;
+};
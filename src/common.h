@@ -17,6 +17,7 @@ using CompressionMap =
 
 struct ModuleConstructors {
   Napi::FunctionReference archive;
+  Napi::FunctionReference archiveHandle;
   Napi::FunctionReference openConfig;
   Napi::FunctionReference illustrationInfo;
   Napi::FunctionReference entry;
@@ -24,8 +25,10 @@ struct ModuleConstructors {
   Napi::FunctionReference blob;
 
   Napi::FunctionReference searcher;
+  Napi::FunctionReference searcherPool;
   Napi::FunctionReference query;
   Napi::FunctionReference search;
+  Napi::FunctionReference searchCursor;
   Napi::FunctionReference searchResultSet;
   Napi::FunctionReference searchIterator;
 
@@ -33,6 +36,8 @@ struct ModuleConstructors {
   Napi::FunctionReference suggestionSearch;
   Napi::FunctionReference suggestionResultSet;
   Napi::FunctionReference suggestionIterator;
+  Napi::FunctionReference autocompleteIndex;
+  Napi::FunctionReference fuzzyTitleIndex;
 
   Napi::FunctionReference stringProvider;
   Napi::FunctionReference fileProvider;
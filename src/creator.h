@@ -13,16 +13,17 @@
 #include <utility>
 
 #include "common.h"
+#include "executor.h"
 #include "illustration.h"
 #include "writerItem.h"
 
 // Handles creator_->finishZimCreation() operations in the background off the
 // main thread.
-class CreatorAsyncWorker : public Napi::AsyncWorker {
+class CreatorAsyncWorker : public ExecutorAsyncWorker {
  public:
   CreatorAsyncWorker(std::shared_ptr<zim::writer::Creator> creator,
                      Napi::Promise::Deferred promise)
-      : Napi::AsyncWorker(promise.Env()),
+      : ExecutorAsyncWorker(promise.Env(), Executor::Priority::Background),
         creator_{creator},
         promise_{promise} {}
 
@@ -51,12 +52,12 @@ class CreatorAsyncWorker : public Napi::AsyncWorker {
   Napi::Promise::Deferred promise_;
 };
 
-class AddItemAsyncWorker : public Napi::AsyncWorker {
+class AddItemAsyncWorker : public ExecutorAsyncWorker {
  public:
   AddItemAsyncWorker(Napi::Env &env,
                      std::shared_ptr<zim::writer::Creator> creator,
                      std::shared_ptr<zim::writer::Item> item)
-      : Napi::AsyncWorker(env),
+      : ExecutorAsyncWorker(env, Executor::Priority::Background),
         creator_{creator},
         item_{item},
         promise_(Napi::Promise::Deferred::New(env)) {}
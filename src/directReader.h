@@ -0,0 +1,286 @@
+#pragma once
+
+#include <fcntl.h>
+#include <napi.h>
+#include <unistd.h>
+#include <zim/item.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * A single outstanding Item.readDirect() call. Created on the main thread,
+ * filled in by a DirectReader thread and resolved back on the main thread
+ * through its ThreadSafeFunction.
+ */
+class DirectReadRequest {
+ public:
+  DirectReadRequest(Napi::Env env, zim::Item item, zim::offset_type offset,
+                    zim::size_type size)
+      : item_{std::move(item)},
+        offset_{offset},
+        size_{size},
+        data_{},
+        error_{},
+        queuedAt_{std::chrono::steady_clock::now()},
+        deferred_{Napi::Promise::Deferred::New(env)},
+        tsfn_{TSFN::New(env, "DirectReadRequest", 0, 1)} {}
+
+  Napi::Promise Promise() const { return deferred_.Promise(); }
+
+  const zim::Item &item() const { return item_; }
+  zim::offset_type offset() const { return offset_; }
+  zim::size_type size() const { return size_; }
+  std::chrono::steady_clock::time_point queuedAt() const { return queuedAt_; }
+
+  std::vector<char> &data() { return data_; }
+  void setError(std::string error) { error_ = std::move(error); }
+  bool failed() const { return !error_.empty(); }
+
+  // Hands the request back to the main thread. The request is deleted there
+  // and must not be touched by the calling thread afterwards.
+  void complete() {
+    auto tsfn = tsfn_;
+    tsfn.BlockingCall(this);
+    tsfn.Release();
+  }
+
+ private:
+  static void CallJs(Napi::Env env, Napi::Function /*callback*/,
+                     void * /*context*/, DirectReadRequest *req) {
+    std::unique_ptr<DirectReadRequest> owned{req};
+    if (env == nullptr) {
+      return;  // environment is shutting down
+    }
+
+    if (req->failed()) {
+      req->deferred_.Reject(Napi::Error::New(env, req->error_).Value());
+      return;
+    }
+    req->deferred_.Resolve(
+        Napi::Buffer<char>::Copy(env, req->data_.data(), req->data_.size()));
+  }
+
+  using TSFN = Napi::TypedThreadSafeFunction<void, DirectReadRequest, CallJs>;
+
+  zim::Item item_;
+  zim::offset_type offset_;
+  zim::size_type size_;
+  std::vector<char> data_;
+  std::string error_;
+  std::chrono::steady_clock::time_point queuedAt_;
+  Napi::Promise::Deferred deferred_;
+  TSFN tsfn_;
+};
+
+/**
+ * Reads uncompressed item data straight from the zim file with pread(2).
+ *
+ * All outstanding reads share one submission queue which a small set of
+ * native reader threads drain one request at a time, so concurrent range
+ * reads are spread over all of them without each holding one of libuv's
+ * (few) worker threads. Items that are not
+ * directly accessible (compressed clusters) fall back to zim::Item::getData on
+ * the same threads.
+ */
+class DirectReader {
+ public:
+  static DirectReader &instance() {
+    // intentionally leaked, reader threads live until the process exits
+    static auto reader = new DirectReader();
+    return *reader;
+  }
+
+  DirectReader(const DirectReader &) = delete;
+  DirectReader &operator=(const DirectReader &) = delete;
+
+  void submit(DirectReadRequest *req) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!started_) {
+        for (size_t i = 0; i < nbThreads_; i++) {
+          std::thread(&DirectReader::run, this).detach();
+        }
+        started_ = true;
+      }
+      queue_.push_back(req);
+      submitted_++;
+      maxQueueDepth_ = std::max(maxQueueDepth_, queue_.size());
+    }
+    cond_.notify_one();
+  }
+
+  Napi::Object stats(Napi::Env env) {
+    auto res = Napi::Object::New(env);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto done = completed_.load() + failed_.load();
+    res["backend"] = "pread";
+    res["threads"] = Napi::Value::From(env, nbThreads_);
+    res["queueDepth"] = Napi::Value::From(env, queue_.size());
+    res["maxQueueDepth"] = Napi::Value::From(env, maxQueueDepth_);
+    res["inFlight"] = Napi::Value::From(env, inFlight_.load());
+    res["submitted"] = Napi::Value::From(env, submitted_);
+    res["completed"] = Napi::Value::From(env, completed_.load());
+    res["failed"] = Napi::Value::From(env, failed_.load());
+    res["bytesRead"] = Napi::Value::From(env, bytesRead_.load());
+    res["avgLatencyMs"] = Napi::Value::From(
+        env, done > 0 ? totalLatencyNs_.load() / 1e6 / done : 0.0);
+    res["maxLatencyMs"] = Napi::Value::From(env, maxLatencyNs_.load() / 1e6);
+    return res;
+  }
+
+ private:
+  // number of zim files kept open for pread
+  static constexpr size_t kMaxOpenFiles = 64;
+
+  struct File {
+    explicit File(const std::string &filename)
+        : fd{::open(filename.c_str(), O_RDONLY | O_CLOEXEC)} {
+      if (fd < 0) {
+        throw std::runtime_error("Unable to open " + filename + ": " +
+                                 std::strerror(errno));
+      }
+    }
+    ~File() { ::close(fd); }
+    int fd;
+  };
+
+  DirectReader()
+      : nbThreads_{std::max(4u, std::thread::hardware_concurrency())},
+        started_{false},
+        submitted_{0},
+        maxQueueDepth_{0},
+        inFlight_{0},
+        completed_{0},
+        failed_{0},
+        bytesRead_{0},
+        totalLatencyNs_{0},
+        maxLatencyNs_{0} {}
+
+  // one request per wakeup: submit() wakes one thread per request, so a
+  // burst of reads is served by all the idle threads in parallel
+  void run() {
+    while (true) {
+      DirectReadRequest *req = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return !queue_.empty(); });
+        req = queue_.front();
+        queue_.pop_front();
+        inFlight_++;
+      }
+
+      process(req);
+      inFlight_--;
+      req->complete();
+    }
+  }
+
+  void process(DirectReadRequest *req) {
+    try {
+      const auto &item = req->item();
+      const auto itemSize = item.getSize();
+      if (req->offset() > itemSize) {
+        throw std::out_of_range("Offset is past the end of the item");
+      }
+      const auto size = std::min<zim::size_type>(req->size(),
+                                                 itemSize - req->offset());
+
+      const auto dai = item.getDirectAccessInformation();
+      auto &data = req->data();
+      if (dai.isValid()) {
+        data.resize(size);
+        auto file = openFile(dai.filename);
+        preadAll(file->fd, data.data(), size, dai.offset + req->offset());
+      } else {
+        auto blob = item.getData(req->offset(), size);
+        data.assign(blob.data(), blob.data() + blob.size());
+      }
+      bytesRead_ += data.size();
+      completed_++;
+    } catch (const std::exception &err) {
+      req->setError(err.what());
+      failed_++;
+    }
+
+    const auto latency = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - req->queuedAt())
+            .count());
+    totalLatencyNs_ += latency;
+    auto max = maxLatencyNs_.load();
+    while (latency > max &&
+           !maxLatencyNs_.compare_exchange_weak(max, latency)) {
+    }
+  }
+
+  std::shared_ptr<File> openFile(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(filesMutex_);
+    auto it = files_.find(filename);
+    if (it != files_.end()) {
+      return it->second;
+    }
+
+    if (files_.size() >= kMaxOpenFiles) {
+      // readers still holding the evicted file keep it open until they are done
+      files_.erase(filesOrder_.front());
+      filesOrder_.pop_front();
+    }
+    auto file = std::make_shared<File>(filename);
+    files_.emplace(filename, file);
+    filesOrder_.push_back(filename);
+    return file;
+  }
+
+  static void preadAll(int fd, char *dest, zim::size_type size,
+                       zim::offset_type offset) {
+    while (size > 0) {
+      auto n = ::pread(fd, dest, size, offset);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        throw std::runtime_error(std::string("pread failed: ") +
+                                 std::strerror(errno));
+      }
+      if (n == 0) {
+        throw std::runtime_error("pread failed: unexpected end of file");
+      }
+      dest += n;
+      offset += n;
+      size -= n;
+    }
+  }
+
+  const size_t nbThreads_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<DirectReadRequest *> queue_;
+  bool started_;
+  uint64_t submitted_;
+  size_t maxQueueDepth_;
+
+  std::mutex filesMutex_;
+  std::unordered_map<std::string, std::shared_ptr<File>> files_;
+  std::deque<std::string> filesOrder_;
+
+  std::atomic<size_t> inFlight_;
+  std::atomic<uint64_t> completed_;
+  std::atomic<uint64_t> failed_;
+  std::atomic<uint64_t> bytesRead_;
+  std::atomic<uint64_t> totalLatencyNs_;
+  std::atomic<uint64_t> maxLatencyNs_;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <napi.h>
+#include <zim/archive.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <regex>
+#include <string>
+#include <unordered_set>
+
+/**
+ * Conditions on an entry's dirent: path, mimetype and item size. Redirects
+ * are skipped unless redirects is set, then the mimetype and size are those
+ * of the target item. The cheap checks run first, the size last as it may
+ * need the cluster.
+ */
+struct EntryFilter {
+  std::unordered_set<std::string> mimetypes;  // empty matches any
+  std::optional<std::regex> pathRegex;        // searched, not anchored
+  uint64_t minSize = 0;
+  uint64_t maxSize = std::numeric_limits<uint64_t>::max();
+  bool redirects = false;
+
+  static EntryFilter From(Napi::Env env, const Napi::Object &options) {
+    EntryFilter filter;
+    auto mimetypes = options.Get("mimetypes");
+    if (!mimetypes.IsUndefined()) {
+      if (!mimetypes.IsArray()) {
+        throw Napi::TypeError::New(env,
+                                   "mimetypes must be an array of strings");
+      }
+      auto array = mimetypes.As<Napi::Array>();
+      for (uint32_t i = 0; i < array.Length(); i++) {
+        filter.mimetypes.insert(array.Get(i).ToString().Utf8Value());
+      }
+    }
+    if (options.Has("pathRegex")) {
+      filter.pathRegex.emplace(
+          options.Get("pathRegex").ToString().Utf8Value());
+    }
+    if (options.Has("minSize")) {
+      filter.minSize = sizeFrom(options.Get("minSize"));
+    }
+    if (options.Has("maxSize")) {
+      filter.maxSize = sizeFrom(options.Get("maxSize"));
+    }
+    filter.redirects = options.Get("redirects").ToBoolean();
+    return filter;
+  }
+
+  bool matches(const zim::Entry &entry) const {
+    if (!redirects && entry.isRedirect()) {
+      return false;
+    }
+    if (pathRegex && !std::regex_search(entry.getPath(), *pathRegex)) {
+      return false;
+    }
+    const bool sized = minSize > 0 ||
+                       maxSize != std::numeric_limits<uint64_t>::max();
+    if (mimetypes.empty() && !sized) {
+      return true;
+    }
+    auto item = entry.getItem(true);
+    if (!mimetypes.empty() && mimetypes.count(item.getMimetype()) == 0) {
+      return false;
+    }
+    if (!sized) {
+      return true;
+    }
+    const uint64_t size = item.getSize();
+    return size >= minSize && size <= maxSize;
+  }
+
+ private:
+  static uint64_t sizeFrom(const Napi::Value &value) {
+    return static_cast<uint64_t>(
+        std::max<int64_t>(value.ToNumber().Int64Value(), 0));
+  }
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <napi.h>
+#include <zim/archive.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Entries copied into plain {index, path, title, ...} records, for listings
+ * that would otherwise wrap every step of a range in an Entry.
+ */
+class EntryListing {
+ public:
+  enum Field : uint32_t {
+    kIndex = 1 << 0,
+    kPath = 1 << 1,
+    kTitle = 1 << 2,
+    kIsRedirect = 1 << 3,
+    kMimetype = 1 << 4,  // read from the item, following redirects
+    kSize = 1 << 5,
+    kRedirectPath = 1 << 6,
+    kItemFields = kIsRedirect | kMimetype | kSize | kRedirectPath,
+  };
+
+  static constexpr uint32_t kDefaultFields = kIndex | kPath | kTitle;
+  static constexpr int64_t kDefaultLimit = 100;
+
+  using FieldNames = std::vector<std::pair<std::string, uint32_t>>;
+
+  // undefined keeps the default fields
+  static uint32_t FieldsFrom(Napi::Env env, const Napi::Value &value) {
+    static const FieldNames names = {
+        {"index", kIndex},
+        {"path", kPath},
+        {"title", kTitle},
+        {"isRedirect", kIsRedirect},
+        {"mimetype", kMimetype},
+        {"size", kSize},
+        {"redirectPath", kRedirectPath},
+    };
+
+    if (value.IsUndefined()) {
+      return kDefaultFields;
+    }
+    return MaskFrom(env, value, names, "fields", "entry");
+  }
+
+  /**
+   * Mask of the names listed in value, an array of strings. option and kind
+   * name the option and its fields in the error messages.
+   */
+  static uint32_t MaskFrom(Napi::Env env, const Napi::Value &value,
+                           const FieldNames &names, const std::string &option,
+                           const std::string &kind) {
+    if (!value.IsArray()) {
+      throw Napi::TypeError::New(env,
+                                 option + " must be an array of strings");
+    }
+    auto array = value.As<Napi::Array>();
+    uint32_t fields = 0;
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      const auto name = array.Get(i).ToString().Utf8Value();
+      auto it = std::find_if(names.begin(), names.end(),
+                             [&](const auto &e) { return e.first == name; });
+      if (it == names.end()) {
+        throw Napi::TypeError::New(env, "Unknown " + kind + " field: " + name);
+      }
+      fields |= it->second;
+    }
+    return fields;
+  }
+
+  static Napi::Object ToObject(Napi::Env env, const zim::Entry &entry,
+                               uint32_t fields) {
+    auto obj = Napi::Object::New(env);
+    if (fields & kIndex) {
+      obj["index"] = Napi::Value::From(env, entry.getIndex());
+    }
+    if (fields & kPath) obj["path"] = entry.getPath();
+    if (fields & kTitle) obj["title"] = entry.getTitle();
+    SetItemFields(env, obj, entry, fields);
+    return obj;
+  }
+
+  /**
+   * The isRedirect, redirectPath, mimetype and size fields, read from the
+   * entry dirent; the item follows redirects. Other bits are ignored.
+   */
+  static void SetItemFields(Napi::Env env, Napi::Object &obj,
+                            const zim::Entry &entry, uint32_t fields) {
+    if (!(fields & kItemFields)) {
+      return;
+    }
+    const bool redirect = entry.isRedirect();
+    if (fields & kIsRedirect) {
+      obj["isRedirect"] = Napi::Boolean::New(env, redirect);
+    }
+    if (fields & kRedirectPath) {
+      obj["redirectPath"] =
+          redirect ? Napi::String::New(env, entry.getRedirectEntry().getPath())
+                   : env.Null();
+    }
+    if (fields & (kMimetype | kSize)) {
+      auto item = entry.getItem(true);
+      if (fields & kMimetype) obj["mimetype"] = item.getMimetype();
+      if (fields & kSize) obj["size"] = Napi::Value::From(env, item.getSize());
+    }
+  }
+
+  /**
+   * {count, start, entries} for [{start, limit, fields}] of range; count is
+   * the size of the whole range.
+   */
+  template <typename RangeT>
+  static Napi::Object Page(Napi::Env env, const RangeT &range,
+                           const Napi::Value &options) {
+    int64_t start = 0;
+    int64_t limit = kDefaultLimit;
+    uint32_t fields = kDefaultFields;
+    if (options.IsObject()) {
+      auto obj = options.As<Napi::Object>();
+      if (obj.Has("start")) {
+        start = std::max<int64_t>(obj.Get("start").ToNumber().Int64Value(), 0);
+      }
+      if (obj.Has("limit")) {
+        limit = std::max<int64_t>(obj.Get("limit").ToNumber().Int64Value(), 0);
+      }
+      fields = FieldsFrom(env, obj.Get("fields"));
+    }
+
+    const int64_t count = range.size();
+    start = std::min(start, count);
+    limit = std::min(limit, count - start);
+    auto page = range.offset(static_cast<int>(start), static_cast<int>(limit));
+
+    auto entries = Napi::Array::New(env, limit);
+    uint32_t i = 0;
+    for (auto it = page.begin(); it != page.end(); it++) {
+      entries.Set(i++, ToObject(env, *it, fields));
+    }
+
+    auto res = Napi::Object::New(env);
+    res["count"] = Napi::Value::From(env, count);
+    res["start"] = Napi::Value::From(env, start);
+    res["entries"] = entries;
+    return res;
+  }
+};
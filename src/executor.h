@@ -0,0 +1,568 @@
+#pragma once
+
+#include <napi.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cancellation.h"
+
+/**
+ * Module-level native thread pool for creator, search and archive
+ * operations, independent of libuv's threadpool (which is shared with fs, dns
+ * and zlib).
+ *
+ * Each thread owns a queue per lane; work submitted from JS is spread over
+ * them round-robin, work submitted from a pool thread stays on that thread's
+ * queue, and idle threads steal from the others. Idle threads always take
+ * interactive work first, and background work may never occupy every thread,
+ * so a burst of background jobs (warming, exports, validation) cannot add
+ * queueing delay to interactive requests.
+ */
+class Executor {
+ public:
+  enum class Priority { Interactive = 0, Background = 1 };
+
+  static constexpr size_t kMaxThreads = 256;
+
+  static Executor &instance() {
+    // intentionally leaked, executor threads live until the process exits
+    static auto executor = new Executor();
+    return *executor;
+  }
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  void submit(Priority priority, std::function<void()> task) {
+    const auto lane = static_cast<size_t>(priority);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size_ == 0) {
+        resize(std::max(2u, std::thread::hardware_concurrency()));
+      }
+    }
+
+    // keep work spawned by a pool thread local to it
+    const auto size = size_.load();
+    auto idx = currentWorker();
+    if (idx < 0 || static_cast<size_t>(idx) >= size) {
+      idx = static_cast<int>(nextWorker_++ % size);
+    }
+    {
+      auto &worker = workers_[idx];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      worker.queues[lane].push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      lanes_[lane].pending++;
+      lanes_[lane].submitted++;
+      pushed_++;
+    }
+    cond_.notify_one();
+    pushedCond_.notify_all();
+  }
+
+  void setSize(size_t nbThreads) {
+    if (nbThreads < 1 || nbThreads > kMaxThreads) {
+      throw std::out_of_range("thread pool size must be between 1 and " +
+                              std::to_string(kMaxThreads));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      resize(nbThreads);
+    }
+    // wake up threads which have to retire
+    cond_.notify_all();
+  }
+
+  /**
+   * Reads the priority from an options object ({priority: 'interactive' |
+   * 'background'}), returning fallback when it is not set.
+   */
+  static Priority priorityFrom(Napi::Env env, const Napi::Value &options,
+                               Priority fallback) {
+    if (!options.IsObject()) {
+      return fallback;
+    }
+    auto value = options.As<Napi::Object>().Get("priority");
+    if (value.IsUndefined()) {
+      return fallback;
+    }
+
+    const auto name = value.ToString().Utf8Value();
+    if (name == "interactive") {
+      return Priority::Interactive;
+    } else if (name == "background") {
+      return Priority::Background;
+    }
+    throw Napi::TypeError::New(
+        env, "priority must be either 'interactive' or 'background'");
+  }
+
+  Napi::Object stats(Napi::Env env) {
+    auto res = Napi::Object::New(env);
+    std::lock_guard<std::mutex> lock(mutex_);
+    res["threads"] = Napi::Value::From(env, size_.load());
+    res["backgroundLimit"] = Napi::Value::From(env, backgroundLimit());
+    res["steals"] = Napi::Value::From(env, steals_.load());
+
+    const auto laneStats = [&](const Lane &lane) {
+      auto obj = Napi::Object::New(env);
+      obj["queued"] = Napi::Value::From(env, lane.pending);
+      obj["running"] = Napi::Value::From(env, lane.running);
+      obj["submitted"] = Napi::Value::From(env, lane.submitted);
+      obj["completed"] = Napi::Value::From(env, lane.completed);
+      return obj;
+    };
+    res["interactive"] = laneStats(lanes_[0]);
+    res["background"] = laneStats(lanes_[1]);
+
+    const auto count = highWater_.load();
+    auto workers = Napi::Array::New(env, count);
+    for (size_t i = 0; i < count; i++) {
+      auto &worker = workers_[i];
+      auto obj = Napi::Object::New(env);
+      obj["alive"] = Napi::Value::From(env, worker.alive);
+      obj["executed"] = Napi::Value::From(env, worker.executed.load());
+      workers.Set(i, obj);
+    }
+    res["workers"] = workers;
+    return res;
+  }
+
+ private:
+  // counters are protected by mutex_
+  struct Lane {
+    size_t pending = 0;
+    size_t running = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::array<std::deque<std::function<void()>>, 2> queues;
+    std::atomic<uint64_t> executed{0};
+    bool alive = false;  // protected by Executor::mutex_
+  };
+
+  Executor()
+      : size_{0}, highWater_{0}, nextWorker_{0}, steals_{0}, pushed_{0} {}
+
+  static int &currentWorker() {
+    static thread_local int idx = -1;
+    return idx;
+  }
+
+  // must be called with mutex_ held
+  void resize(size_t nbThreads) {
+    size_ = nbThreads;
+    for (size_t i = 0; i < nbThreads; i++) {
+      // a retiring thread which has not exited yet simply carries on
+      if (!workers_[i].alive) {
+        workers_[i].alive = true;
+        std::thread(&Executor::run, this, i).detach();
+      }
+    }
+    highWater_ = std::max(highWater_.load(), nbThreads);
+  }
+
+  /**
+   * Keeps at least a quarter of the threads for interactive work. A pool of
+   * one thread is the exception: background work may take it, as it would
+   * never run otherwise (swap(), preloads and prefetches would hang), so
+   * interactive work can then wait behind one background task.
+   * Must be called with mutex_ held.
+   */
+  size_t backgroundLimit() const {
+    const auto size = size_.load();
+    return std::max<size_t>(1, size - std::max<size_t>(1, size / 4));
+  }
+
+  // must be called with mutex_ held
+  bool nextLane(size_t &lane) const {
+    if (lanes_[0].pending > 0) {
+      lane = 0;
+      return true;
+    }
+    if (lanes_[1].pending > 0 && lanes_[1].running < backgroundLimit()) {
+      lane = 1;
+      return true;
+    }
+    return false;
+  }
+
+  std::function<void()> take(size_t idx, size_t lane) {
+    // a task was claimed under mutex_ so one is queued somewhere, but it may
+    // sit in a queue already scanned by the time it is pushed. Such a task
+    // was counted after the scan started: wait for pushed_ to move, rescan.
+    while (true) {
+      const auto pushed = pushed_.load();
+      {
+        auto &own = workers_[idx];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.queues[lane].empty()) {
+          auto task = std::move(own.queues[lane].front());
+          own.queues[lane].pop_front();
+          return task;
+        }
+      }
+
+      const auto count = highWater_.load();
+      for (size_t i = 1; i < count; i++) {
+        auto &victim = workers_[(idx + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.queues[lane].empty()) {
+          auto task = std::move(victim.queues[lane].front());
+          victim.queues[lane].pop_front();
+          steals_++;
+          return task;
+        }
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      pushedCond_.wait(lock, [&] { return pushed_.load() != pushed; });
+    }
+  }
+
+  void run(size_t idx) {
+    currentWorker() = static_cast<int>(idx);
+    auto &worker = workers_[idx];
+    while (true) {
+      size_t lane = 0;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [&] { return idx >= size_ || nextLane(lane); });
+        if (idx >= size_) {
+          // anything left in this thread's queues gets stolen by the others
+          worker.alive = false;
+          return;
+        }
+        lanes_[lane].pending--;
+        lanes_[lane].running++;
+      }
+
+      auto task = take(idx, lane);
+      task();
+      worker.executed++;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lanes_[lane].running--;
+        lanes_[lane].completed++;
+      }
+    }
+  }
+
+  std::atomic<size_t> size_;
+  // number of worker slots that ever had a thread
+  std::atomic<size_t> highWater_;
+  std::atomic<size_t> nextWorker_;
+  std::atomic<uint64_t> steals_;
+  // tasks ever submitted, incremented under mutex_
+  std::atomic<uint64_t> pushed_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  // notified on every submit, for take() waiting on a task being pushed
+  std::condition_variable pushedCond_;
+  std::array<Lane, 2> lanes_;
+  std::array<Worker, kMaxThreads> workers_;
+};
+
+/**
+ * Hands a task to the Executor, possibly later: resource pools use it to hold
+ * work back until it can run without waiting on an executor thread.
+ */
+using ExecutorSubmitFunc =
+    std::function<void(Executor::Priority, std::function<void()>)>;
+
+/**
+ * Same contract as Napi::AsyncWorker but Execute() runs on the Executor
+ * instead of the libuv threadpool. OnOK()/OnError() are called on the main
+ * thread, after which the worker deletes itself.
+ *
+ * NOTE: MUST BE created on the main thread
+ */
+class ExecutorAsyncWorker {
+ public:
+  explicit ExecutorAsyncWorker(
+      Napi::Env env,
+      Executor::Priority priority = Executor::Priority::Interactive)
+      : env_{env},
+        priority_{priority},
+        error_{},
+        tsfn_{TSFN::New(env, "ExecutorAsyncWorker", 0, 1)} {}
+
+  virtual ~ExecutorAsyncWorker() {}
+
+  Napi::Env Env() const { return env_; }
+
+  void Queue() {
+    submit([this]() {
+      if (Expired()) {
+        skipped_ = true;
+      } else {
+        try {
+          Execute();
+        } catch (const std::exception &err) {
+          SetError(err.what());
+        }
+      }
+      Complete();
+    });
+  }
+
+  // tasks go through submit instead of straight to the Executor
+  void SetSubmit(ExecutorSubmitFunc submit) { submit_ = std::move(submit); }
+
+ protected:
+  virtual void Execute() = 0;
+  virtual void OnOK() = 0;
+  virtual void OnError(const Napi::Error &error) = 0;
+
+  void SetError(const std::string &error) { error_ = error; }
+
+  /**
+   * Skips Execute() when the call's deadline or signal expired before it
+   * started, and drops the result when the promise was already rejected.
+   */
+  void SetCancellation(std::shared_ptr<Cancellation> cancellation) {
+    cancellation_ = std::move(cancellation);
+  }
+
+  bool Expired() const {
+    return cancellation_ != nullptr && cancellation_->expired();
+  }
+
+  void Skip() { skipped_ = true; }
+
+  // the worker may be deleted before this returns, nothing of it is used
+  // once the task is handed over
+  void submit(std::function<void()> task) {
+    const auto priority = priority_;
+    if (submit_) {
+      auto submit = submit_;
+      submit(priority, std::move(task));
+    } else {
+      Executor::instance().submit(priority, std::move(task));
+    }
+  }
+
+  // Hands the worker back to the main thread for OnOK()/OnError(). It may be
+  // deleted as soon as this is called.
+  void Complete() {
+    auto tsfn = tsfn_;
+    tsfn.BlockingCall(this);
+    tsfn.Release();
+  }
+
+ private:
+  static void CallJs(Napi::Env env, Napi::Function /*callback*/,
+                     void * /*context*/, ExecutorAsyncWorker *worker) {
+    std::unique_ptr<ExecutorAsyncWorker> owned{worker};
+    if (env == nullptr) {
+      return;  // environment is shutting down
+    }
+
+    auto &cancellation = worker->cancellation_;
+    if (cancellation != nullptr) {
+      if (worker->skipped_) {
+        cancellation->reject(env);
+        return;
+      }
+      if (!cancellation->finish(env)) {
+        return;  // already rejected by the deadline or the signal
+      }
+    }
+
+    try {
+      if (worker->error_.empty()) {
+        worker->OnOK();
+      } else {
+        worker->OnError(Napi::Error::New(env, worker->error_));
+      }
+    } catch (const Napi::Error &err) {
+      err.ThrowAsJavaScriptException();
+    }
+  }
+
+  using TSFN =
+      Napi::TypedThreadSafeFunction<void, ExecutorAsyncWorker, CallJs>;
+
+  Napi::Env env_;
+  Executor::Priority priority_;
+  std::string error_;
+  std::shared_ptr<Cancellation> cancellation_;
+  ExecutorSubmitFunc submit_;
+  std::atomic<bool> skipped_{false};
+  TSFN tsfn_;
+};
+
+/**
+ * Runs execute() on the Executor and settles a promise with the value built
+ * by resolve() on the main thread, rejecting if either of them throws.
+ */
+template <typename ResultT>
+class ExecutorPromiseWorker : public ExecutorAsyncWorker {
+ public:
+  using ExecuteFunc = std::function<ResultT()>;
+  using ResolveFunc = std::function<Napi::Value(Napi::Env, ResultT &)>;
+
+  static Napi::Promise Run(
+      Napi::Env env, Executor::Priority priority, ExecuteFunc execute,
+      ResolveFunc resolve,
+      std::shared_ptr<Cancellation> cancellation = nullptr,
+      ExecutorSubmitFunc submit = nullptr) {
+    auto wk = new ExecutorPromiseWorker(env, priority, std::move(execute),
+                                        std::move(resolve));
+    auto promise = wk->deferred_.Promise();
+    if (cancellation != nullptr) {
+      cancellation->arm(env, wk->deferred_);
+      wk->SetCancellation(std::move(cancellation));
+    }
+    wk->SetSubmit(std::move(submit));
+    wk->Queue();
+    return promise;
+  }
+
+ protected:
+  void Execute() override { result_ = std::make_unique<ResultT>(execute_()); }
+
+  void OnOK() override {
+    auto env = Env();
+    try {
+      deferred_.Resolve(resolve_(env, *result_));
+    } catch (const std::exception &err) {
+      deferred_.Reject(Napi::Error::New(env, err.what()).Value());
+    }
+  }
+
+  void OnError(const Napi::Error &error) override {
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  ExecutorPromiseWorker(Napi::Env env, Executor::Priority priority,
+                        ExecuteFunc execute, ResolveFunc resolve)
+      : ExecutorAsyncWorker(env, priority),
+        execute_{std::move(execute)},
+        resolve_{std::move(resolve)},
+        result_{nullptr},
+        deferred_{Napi::Promise::Deferred::New(env)} {}
+
+  ExecuteFunc execute_;
+  ResolveFunc resolve_;
+  std::unique_ptr<ResultT> result_;
+  Napi::Promise::Deferred deferred_;
+};
+
+/**
+ * Runs a batch of independent tasks in parallel on the Executor and settles a
+ * single promise once all of them are done: resolve() gets the results in
+ * task order, the first failure rejects.
+ */
+template <typename ResultT>
+class ExecutorBatchWorker : public ExecutorAsyncWorker {
+ public:
+  using ExecuteFunc = std::function<ResultT()>;
+  using ResolveFunc =
+      std::function<Napi::Value(Napi::Env, std::vector<ResultT> &)>;
+
+  static Napi::Promise Run(
+      Napi::Env env, Executor::Priority priority,
+      std::vector<ExecuteFunc> tasks, ResolveFunc resolve,
+      std::shared_ptr<Cancellation> cancellation = nullptr,
+      ExecutorSubmitFunc submit = nullptr) {
+    auto wk = new ExecutorBatchWorker(env, priority, std::move(tasks),
+                                      std::move(resolve));
+    auto promise = wk->deferred_.Promise();
+    if (cancellation != nullptr) {
+      cancellation->arm(env, wk->deferred_);
+      wk->SetCancellation(std::move(cancellation));
+    }
+    wk->SetSubmit(std::move(submit));
+    if (wk->tasks_.empty()) {
+      wk->Queue();
+      return promise;
+    }
+    const auto count = wk->tasks_.size();
+    for (size_t i = 0; i < count; i++) {
+      wk->submit([wk, i]() { wk->runTask(i); });
+    }
+    return promise;
+  }
+
+ protected:
+  void Execute() override {}
+
+  void OnOK() override {
+    auto env = Env();
+    try {
+      std::vector<ResultT> results;
+      results.reserve(results_.size());
+      for (auto &res : results_) {
+        results.push_back(std::move(*res));
+      }
+      deferred_.Resolve(resolve_(env, results));
+    } catch (const std::exception &err) {
+      deferred_.Reject(Napi::Error::New(env, err.what()).Value());
+    }
+  }
+
+  void OnError(const Napi::Error &error) override {
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  ExecutorBatchWorker(Napi::Env env, Executor::Priority priority,
+                      std::vector<ExecuteFunc> tasks, ResolveFunc resolve)
+      : ExecutorAsyncWorker(env, priority),
+        tasks_{std::move(tasks)},
+        resolve_{std::move(resolve)},
+        results_(tasks_.size()),
+        remaining_{tasks_.size()},
+        deferred_{Napi::Promise::Deferred::New(env)} {}
+
+  void runTask(size_t i) {
+    try {
+      if (Expired()) {
+        Skip();
+      } else {
+        results_[i] = std::make_unique<ResultT>(tasks_[i]());
+      }
+    } catch (const std::exception &err) {
+      std::lock_guard<std::mutex> lock(errorMutex_);
+      if (!failed_) {
+        failed_ = true;
+        SetError(err.what());
+      }
+    }
+    if (--remaining_ == 0) {
+      Complete();
+    }
+  }
+
+  std::vector<ExecuteFunc> tasks_;
+  ResolveFunc resolve_;
+  std::vector<std::unique_ptr<ResultT>> results_;
+  std::atomic<size_t> remaining_;
+  std::mutex errorMutex_;
+  bool failed_ = false;
+  Napi::Promise::Deferred deferred_;
+};
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <napi.h>
+#include <zim/archive.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "archive.h"
+#include "archiveHandle.h"
+#include "cancellation.h"
+#include "common.h"
+#include "executor.h"
+
+/**
+ * Compact dictionary of the archive titles for typo tolerant lookups.
+ *
+ * The ASCII lowercased titles are kept sorted in a single blob, which is
+ * walked as an implicit trie (each child is a binary searched sub range)
+ * while computing the edit distance row by row, so only branches still
+ * within maxDistance are visited. The distance is the optimal string
+ * alignment one: insertions, deletions, substitutions and transpositions of
+ * adjacent bytes ("pytohn" is 1 away from "python").
+ *
+ * Like SymSpell's prefix length, the first fixedPrefix bytes must match
+ * exactly by default: typos rarely hit the first letter and the branches
+ * near the root are where the walk spends its time.
+ */
+class FuzzyTitleData {
+ public:
+  static constexpr uint32_t kMaxDistance = 3;
+  static constexpr uint32_t kDefaultFixedPrefix = 1;
+
+  struct Match {
+    uint32_t entryIndex;
+    uint32_t distance;
+  };
+
+  static std::shared_ptr<FuzzyTitleData> Build(const zim::Archive &archive) {
+    std::vector<std::pair<std::string, uint32_t>> titles;
+    titles.reserve(archive.getEntryCount());
+    for (const auto &entry : archive.iterByTitle()) {
+      titles.emplace_back(normalize(entry.getTitle()), entry.getIndex());
+    }
+    // stable, so the first entry of a title in title order wins
+    std::stable_sort(
+        titles.begin(), titles.end(),
+        [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    auto res = std::make_shared<FuzzyTitleData>();
+    const std::string *previous = nullptr;
+    for (auto &title : titles) {
+      if (previous != nullptr && *previous == title.first) {
+        continue;
+      }
+      previous = &title.first;
+      res->offsets_.push_back(res->blob_.size());
+      res->entries_.push_back(title.second);
+      res->blob_ += title.first;
+    }
+    res->offsets_.push_back(res->blob_.size());
+    res->blob_.shrink_to_fit();
+    res->offsets_.shrink_to_fit();
+    res->entries_.shrink_to_fit();
+    return res;
+  }
+
+  /**
+   * Best titles within maxDistance of text, by distance then title order.
+   * With prefix, text is matched against the beginning of the titles.
+   */
+  std::vector<Match> search(const std::string &text, uint32_t maxDistance,
+                            size_t max, bool prefix,
+                            uint32_t fixedPrefix) const {
+    Walk walk{normalize(text), maxDistance, prefix, fixedPrefix, {}, {}};
+    std::vector<uint8_t> row(walk.query.size() + 1);
+    for (size_t i = 0; i < row.size(); i++) {
+      row[i] = clip(i, maxDistance);
+    }
+    // no branch deeper than the query plus maxDistance is within distance
+    walk.rows.resize(walk.query.size() + maxDistance + 2);
+    visit(walk, 0, size(), 0, row, nullptr, 0);
+
+    std::stable_sort(walk.found.begin(), walk.found.end(),
+                     [](const Found &a, const Found &b) {
+                       return a.distance < b.distance;
+                     });
+    std::vector<Match> res;
+    std::unordered_set<size_t> seen;
+    for (const auto &found : walk.found) {
+      for (size_t k = found.lo; k < found.hi && res.size() < max; k++) {
+        if (seen.insert(k).second) {
+          res.push_back(Match{entries_[k], found.distance});
+        }
+      }
+      if (res.size() >= max) {
+        break;
+      }
+    }
+    return res;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+  size_t bytes() const {
+    return blob_.capacity() + offsets_.capacity() * sizeof(uint32_t) +
+           entries_.capacity() * sizeof(uint32_t);
+  }
+
+ private:
+  // [lo, hi) titles matching at distance
+  struct Found {
+    size_t lo;
+    size_t hi;
+    uint32_t distance;
+  };
+
+  struct Walk {
+    std::string query;
+    uint32_t maxDistance;
+    bool prefix;
+    uint32_t fixedPrefix;
+    std::vector<Found> found;
+    std::vector<std::vector<uint8_t>> rows;  // one per depth, reused
+  };
+
+  static uint8_t clip(size_t value, uint32_t maxDistance) {
+    return static_cast<uint8_t>(std::min<size_t>(value, maxDistance + 1));
+  }
+
+  static std::string normalize(const std::string &text) {
+    std::string res = text;
+    for (auto &c : res) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return res;
+  }
+
+  size_t length(size_t k) const { return offsets_[k + 1] - offsets_[k]; }
+
+  uint8_t charAt(size_t k, size_t depth) const {
+    return static_cast<uint8_t>(blob_[offsets_[k] + depth]);
+  }
+
+  /**
+   * Titles in [lo, hi) share their first depth bytes, row is the distance
+   * row of that prefix and prevRow / prevChar the ones of its parent.
+   */
+  void visit(Walk &walk, size_t lo, size_t hi, size_t depth,
+             const std::vector<uint8_t> &row,
+             const std::vector<uint8_t> *prevRow, uint8_t prevChar) const {
+    const auto &query = walk.query;
+    const auto maxDistance = walk.maxDistance;
+
+    // titles ending here sort first
+    size_t start = lo;
+    while (start < hi && length(start) == depth) {
+      if (!walk.prefix && row.back() <= maxDistance) {
+        walk.found.push_back(Found{start, start + 1, row.back()});
+      }
+      start++;
+    }
+
+    auto &next = walk.rows[depth];
+    next.resize(row.size());
+    while (start < hi) {
+      // the child for c is the run of titles with c at depth
+      const auto c = charAt(start, depth);
+      size_t end = start + 1;
+      size_t last = hi;
+      while (end < last) {
+        const auto mid = end + (last - end) / 2;
+        if (charAt(mid, depth) == c) {
+          end = mid + 1;
+        } else {
+          last = mid;
+        }
+      }
+
+      if (depth < walk.fixedPrefix &&
+          (depth >= query.size() || static_cast<uint8_t>(query[depth]) != c)) {
+        start = end;
+        continue;
+      }
+
+      next[0] = clip(depth + 1, maxDistance);
+      uint8_t best = next[0];
+      for (size_t i = 1; i < next.size(); i++) {
+        const uint8_t q = query[i - 1];
+        size_t value = std::min<size_t>(row[i] + 1, next[i - 1] + 1);
+        value = std::min<size_t>(value, row[i - 1] + (q == c ? 0 : 1));
+        if (prevRow != nullptr && i > 1 && q == prevChar &&
+            static_cast<uint8_t>(query[i - 2]) == c) {
+          value = std::min<size_t>(value, (*prevRow)[i - 2] + 1);
+        }
+        next[i] = clip(value, maxDistance);
+        best = std::min(best, next[i]);
+      }
+
+      if (walk.prefix && next.back() <= maxDistance) {
+        walk.found.push_back(Found{start, end, next.back()});
+      }
+      if (best <= maxDistance && !(walk.prefix && next.back() == 0)) {
+        visit(walk, start, end, depth + 1, next, &row, c);
+      }
+      start = end;
+    }
+  }
+
+  std::string blob_;
+  std::vector<uint32_t> offsets_;  // size() + 1 offsets into blob_
+  std::vector<uint32_t> entries_;  // entry index (path order) of each title
+};
+
+class FuzzyTitleIndex : public Napi::ObjectWrap<FuzzyTitleIndex> {
+ public:
+  explicit FuzzyTitleIndex(const Napi::CallbackInfo &info)
+      : Napi::ObjectWrap<FuzzyTitleIndex>(info),
+        archive_{nullptr},
+        data_{nullptr} {
+    if (!info[0].IsExternal()) {
+      throw Napi::Error::New(info.Env(),
+                             "FuzzyTitleIndex must be created with build().");
+    }
+    auto &state = *info[0].As<Napi::External<State>>().Data();
+    archive_ = state.first;
+    data_ = state.second;
+  }
+
+  static Napi::Object New(Napi::Env env, std::shared_ptr<zim::Archive> archive,
+                          std::shared_ptr<FuzzyTitleData> data) {
+    State state{std::move(archive), std::move(data)};
+    auto external = Napi::External<State>::New(env, &state);
+    auto &constructor =
+        env.GetInstanceData<ModuleConstructors>()->fuzzyTitleIndex;
+    return constructor.New({external});
+  }
+
+  // build(archive, [{priority}]) reads the titles in the background lane
+  static Napi::Value build(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      if (!info[0].IsObject()) {
+        throw Napi::TypeError::New(env, "archive must be an Archive object");
+      }
+      auto archive =
+          ArchiveHandle::slotFrom(env, info[0].As<Napi::Object>())->archive();
+      const auto priority = Executor::priorityFrom(
+          env, info[1], Executor::Priority::Background);
+      return ExecutorPromiseWorker<std::shared_ptr<FuzzyTitleData>>::Run(
+          env, priority,
+          [archive]() { return FuzzyTitleData::Build(*archive); },
+          [archive](Napi::Env env, std::shared_ptr<FuzzyTitleData> &data) {
+            return New(env, archive, data);
+          });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  /**
+   * suggest(text, [{maxDistance, max, prefix, fixedPrefix}]) returns
+   * [{title, path, index, distance}], closest first. maxDistance defaults
+   * to 2 (at most 3), max to 10 and fixedPrefix to 1.
+   *
+   * A lookup takes about 2ms on 2M titles with the default options, growing
+   * with the number of titles and with maxDistance; it does not stay under a
+   * millisecond on the largest archives. With {async: true, priority,
+   * signal, timeoutMs} it runs on the executor (interactive lane by default)
+   * and resolves with the same array instead of holding the main thread.
+   */
+  Napi::Value suggest(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      if (!info[0].IsString()) {
+        throw Napi::TypeError::New(env, "text must be a string");
+      }
+      const std::string text = info[0].ToString();
+      uint32_t maxDistance = kDefaultDistance;
+      size_t max = kDefaultMax;
+      bool prefix = false;
+      uint32_t fixedPrefix = FuzzyTitleData::kDefaultFixedPrefix;
+      if (info[1].IsObject()) {
+        auto options = info[1].As<Napi::Object>();
+        if (options.Has("maxDistance")) {
+          const auto value =
+              options.Get("maxDistance").ToNumber().Int64Value();
+          if (value < 0 || value > FuzzyTitleData::kMaxDistance) {
+            throw Napi::RangeError::New(
+                env, "maxDistance must be between 0 and " +
+                         std::to_string(FuzzyTitleData::kMaxDistance));
+          }
+          maxDistance = static_cast<uint32_t>(value);
+        }
+        if (options.Has("max")) {
+          max = std::max<int64_t>(options.Get("max").ToNumber().Int64Value(),
+                                  0);
+        }
+        prefix = options.Get("prefix").ToBoolean();
+        if (options.Has("fixedPrefix")) {
+          fixedPrefix = static_cast<uint32_t>(std::max<int64_t>(
+              options.Get("fixedPrefix").ToNumber().Int64Value(), 0));
+        }
+      }
+
+      auto archive = archive_;
+      auto data = data_;
+      auto lookup = [archive, data, text, maxDistance, max, prefix,
+                     fixedPrefix]() {
+        std::vector<Suggestion> res;
+        for (const auto &match :
+             data->search(text, maxDistance, max, prefix, fixedPrefix)) {
+          auto entry = archive->getEntryByPath(match.entryIndex);
+          res.push_back(Suggestion{entry.getTitle(), entry.getPath(),
+                                   match.entryIndex, match.distance});
+        }
+        return res;
+      };
+
+      const auto options = info[1];
+      if (options.IsObject() &&
+          options.As<Napi::Object>().Get("async").ToBoolean()) {
+        const auto priority = Executor::priorityFrom(
+            env, options, Executor::Priority::Interactive);
+        return ExecutorPromiseWorker<std::vector<Suggestion>>::Run(
+            env, priority, lookup, ToArray, Cancellation::From(env, options));
+      }
+
+      auto suggestions = lookup();
+      return ToArray(env, suggestions);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  Napi::Value getSize(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), data_->size());
+  }
+
+  Napi::Value getMemoryBytes(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), data_->bytes());
+  }
+
+  static void Init(Napi::Env env, Napi::Object exports,
+                   ModuleConstructors &constructors) {
+    Napi::Function func = DefineClass(
+        env, "FuzzyTitleIndex",
+        {
+            InstanceMethod<&FuzzyTitleIndex::suggest>("suggest"),
+            InstanceAccessor<&FuzzyTitleIndex::getSize>("size"),
+            InstanceAccessor<&FuzzyTitleIndex::getMemoryBytes>("memoryBytes"),
+            StaticMethod<&FuzzyTitleIndex::build>("build"),
+        });
+
+    exports.Set("FuzzyTitleIndex", func);
+    constructors.fuzzyTitleIndex = Napi::Persistent(func);
+  }
+
+ private:
+  static constexpr uint32_t kDefaultDistance = 2;
+  static constexpr size_t kDefaultMax = 10;
+
+  using State = std::pair<std::shared_ptr<zim::Archive>,
+                          std::shared_ptr<FuzzyTitleData>>;
+
+  // a match with its entry fields, read off the main thread when async
+  struct Suggestion {
+    std::string title;
+    std::string path;
+    uint32_t index;
+    uint32_t distance;
+  };
+
+  static Napi::Value ToArray(Napi::Env env,
+                             std::vector<Suggestion> &suggestions) {
+    auto res = Napi::Array::New(env, suggestions.size());
+    for (size_t i = 0; i < suggestions.size(); i++) {
+      const auto &suggestion = suggestions[i];
+      auto obj = Napi::Object::New(env);
+      obj["title"] = suggestion.title;
+      obj["path"] = suggestion.path;
+      obj["index"] = Napi::Value::From(env, suggestion.index);
+      obj["distance"] = Napi::Value::From(env, suggestion.distance);
+      res.Set(i, obj);
+    }
+    return res;
+  }
+
+  std::shared_ptr<zim::Archive> archive_;
+  std::shared_ptr<FuzzyTitleData> data_;
+};
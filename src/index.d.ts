@@ -2,6 +2,52 @@ export declare function getClusterCacheMaxSize(): number;
 export declare function getClusterCacheCurrentSize(): number;
 export declare function setClusterCacheMaxSize(nbClusters: number): void;
 
+export interface DirectReadStats {
+  backend: "pread";
+  threads: number;
+  queueDepth: number;
+  maxQueueDepth: number;
+  inFlight: number;
+  submitted: number;
+  completed: number;
+  failed: number;
+  bytesRead: number;
+  avgLatencyMs: number;
+  maxLatencyMs: number;
+}
+export declare function getDirectReadStats(): DirectReadStats;
+
+export type Priority = "interactive" | "background";
+export interface AsyncOptions {
+  priority?: Priority;
+}
+
+export interface ExecutorLaneStats {
+  queued: number;
+  running: number;
+  submitted: number;
+  completed: number;
+}
+export interface ExecutorWorkerStats {
+  alive: boolean;
+  executed: number;
+}
+export interface ExecutorStats {
+  threads: number;
+  /**
+   * background tasks allowed to run at once, which leaves interactive work at
+   * least a quarter of the threads; with a single thread, background work may
+   * take it
+   */
+  backgroundLimit: number;
+  steals: number;
+  interactive: ExecutorLaneStats;
+  background: ExecutorLaneStats;
+  workers: ExecutorWorkerStats[];
+}
+export declare function getExecutorStats(): ExecutorStats;
+export declare function setThreadPoolSize(nbThreads: number): void;
+
 export class IntegrityCheck {
   static CHECKSUM: symbol;
   static DIRENT_PTRS: symbol;
@@ -130,6 +176,12 @@ export class Item {
   get mimetype(): string;
   get data(): Blob;
   getData(offset?: number | bigint, limit?: number | bigint): Blob;
+  getDataAsync(
+    offset?: number | bigint,
+    limit?: number | bigint,
+    options?: AsyncOptions,
+  ): Promise<Blob>;
+  readDirect(offset?: number | bigint, limit?: number | bigint): Promise<Buffer>;
   get size(): number | bigint;
   get directAccessInformation(): {
     filename: string;
@@ -181,8 +233,98 @@ export class OpenConfig {
   get m_preloadDirentRanges(): number;
 }
 
+export interface FdRange {
+  offset?: number | bigint;
+  size?: number | bigint;
+}
+
+export interface IndexPreloadProgress {
+  phase: "read" | "open";
+  bytesRead: number;
+  totalBytes: number;
+}
+
+export interface IndexPreloadOptions {
+  onProgress?: (progress: IndexPreloadProgress) => void;
+}
+
+export interface IndexPreloadResult {
+  /** The index item was found and its bytes read into the page cache. */
+  found: boolean;
+  /**
+   * The database was opened; the next Searcher / SuggestionSearcher built
+   * over this archive alone runs its synchronous calls on it, async searches
+   * and cursors share it. Pools open the archive again, reading the
+   * preloaded pages.
+   */
+  opened: boolean;
+  bytesRead: number;
+  totalBytes: number;
+  elapsedMs: number;
+}
+
+export type EntryField =
+  | "index"
+  | "path"
+  | "title"
+  | "isRedirect"
+  | "mimetype"
+  | "size"
+  | "redirectPath";
+
+export interface EntryRecord {
+  index?: number;
+  path?: string;
+  title?: string;
+  isRedirect?: boolean;
+  mimetype?: string;
+  size?: number;
+  redirectPath?: string | null;
+}
+
+export interface ListOptions {
+  start?: number;
+  /** 100 by default */
+  limit?: number;
+  /** ["index", "path", "title"] by default */
+  fields?: EntryField[];
+}
+
+export interface SampleOptions {
+  /** true by default */
+  frontArticlesOnly?: boolean;
+  mimetypes?: string[];
+  minSize?: number;
+  /** draws the same samples for the same archive and options */
+  seed?: number;
+  fields?: EntryField[];
+}
+
+export interface ScanFilter {
+  mimetypes?: string[];
+  /** searched anywhere in the path */
+  pathRegex?: string;
+  minSize?: number;
+  maxSize?: number;
+  /** include redirects, filtered on their target item */
+  redirects?: boolean;
+}
+
+export interface ScanOptions {
+  /** hardware concurrency by default */
+  threads?: number;
+}
+
+export interface EntryListing {
+  /** number of entries matching the prefix */
+  count: number;
+  start: number;
+  entries: EntryRecord[];
+}
+
 export class Archive {
   constructor(filepath: string, config?: OpenConfig);
+  static fromFd(fd: number, range?: FdRange, config?: OpenConfig): Archive;
   get filename(): string;
   get filesize(): number | bigint;
   get allEntryCount(): number;
@@ -206,21 +348,49 @@ export class Archive {
   getEntryByClusterOrder(idx: number): Entry;
   get mainEntry(): Entry;
   get randomEntry(): Entry;
+  sampleEntries(n: number, options?: SampleOptions): EntryRecord[];
+  scan(
+    filter?: ScanFilter,
+    options?: ScanOptions & AsyncOptions & CancelOptions,
+  ): Promise<Uint32Array>;
   hasEntryByPath(path: string): boolean;
   hasEntryByTitle(title: string): boolean;
   hasMainEntry(): boolean;
   hasIllustration(size: number): boolean;
   hasFulltextIndex(): boolean;
   hasTitleIndex(): boolean;
+  preloadFulltextIndex(
+    options?: IndexPreloadOptions & { async?: false },
+  ): IndexPreloadResult;
+  preloadFulltextIndex(
+    options: IndexPreloadOptions &
+      AsyncOptions &
+      CancelOptions & { async: true },
+  ): Promise<IndexPreloadResult>;
+  preloadTitleIndex(
+    options?: IndexPreloadOptions & { async?: false },
+  ): IndexPreloadResult;
+  preloadTitleIndex(
+    options: IndexPreloadOptions &
+      AsyncOptions &
+      CancelOptions & { async: true },
+  ): Promise<IndexPreloadResult>;
   iterByPath(): EntryRange;
   iterByTitle(): EntryRange;
   iterEfficient(): EntryRange;
   findByPath(path: string): EntryRange;
   findByTitle(title: string): EntryRange;
+  listByPathPrefix(prefix: string, options?: ListOptions): EntryListing;
+  listByTitlePrefix(prefix: string, options?: ListOptions): EntryListing;
   get hasChecksum(): boolean;
   get checksum(): string;
   check(): boolean;
   checkIntegrity(checkType: symbol): boolean; // one of IntegrityCheck
+  checkAsync(options?: AsyncOptions): Promise<boolean>;
+  checkIntegrityAsync(
+    checkType: symbol,
+    options?: AsyncOptions,
+  ): Promise<boolean>;
   get isMultiPart(): boolean;
   get hasNewNamespaceScheme(): boolean;
   getDirentCacheMaxSize(): number;
@@ -228,6 +398,19 @@ export class Archive {
   setDirentCacheMaxSize(nbDirents: number): void;
 
   static validate(zimPath: string, checksToRun: symbol[]): boolean; // list of IntegrityCheck
+  static validateAsync(
+    zimPath: string,
+    checksToRun: symbol[],
+    options?: AsyncOptions,
+  ): Promise<boolean>;
+}
+
+export class ArchiveHandle {
+  constructor(filepath: string, config?: OpenConfig);
+  get archive(): Archive;
+  get filename(): string;
+  get generation(): number;
+  swap(filepath: string, config?: OpenConfig): Promise<Archive>;
 }
 
 interface Georange {
@@ -251,27 +434,240 @@ export class SearchIterator {
   get path(): string;
   get title(): string;
   get score(): number;
+  /**
+   * Generated on access unless collected with the page, which async pages
+   * do unless {snippets: false}. Generating it blocks the JS thread until
+   * the Xapian database of the page's archives is free, that is until a
+   * query running over them on the executor (searchAsync(), cursor(),
+   * searchMany(), SearcherPool) is done.
+   */
   get snippet(): string;
+  get structuredSnippet(): StructuredSnippet;
   get wordCount(): number;
   get fileIndex(): number;
   get zimId(): string;
   get entry(): Entry;
 }
 
+export type SearchResultField =
+  | "path"
+  | "title"
+  | "score"
+  | "snippet"
+  | "wordCount"
+  | "fileIndex"
+  | "zimId"
+  | "mimetype"
+  | "size"
+  | "isRedirect"
+  | "redirectPath";
+
+export interface StructuredSnippet {
+  text: string;
+  /** [start, end) pairs of highlighted UTF-16 offsets in text */
+  highlights: Uint32Array;
+}
+
+export interface SearchResult {
+  path?: string;
+  title?: string;
+  score?: number;
+  snippet?: string | StructuredSnippet;
+  wordCount?: number;
+  fileIndex?: number;
+  zimId?: string;
+  mimetype?: string;
+  size?: number;
+  isRedirect?: boolean;
+  redirectPath?: string | null;
+}
+
+export interface SearchResultIncludeOptions {
+  include?: SearchResultField[];
+}
+
+export interface SearchResultArrayOptions extends SearchResultIncludeOptions {
+  fields?: SearchResultField[];
+  snippets?: boolean | "html" | "structured";
+}
+
 export interface SearchResultSet extends Iterable<SearchIterator> {
   readonly size: number;
+  toArray(options?: SearchResultArrayOptions): SearchResult[];
+}
+
+export interface ColumnarSearchResults {
+  entryIndexes: Uint32Array;
+  scores: Float32Array;
+  fileIndexes: Uint16Array;
+  /** zim id of every archive searched, indexed by fileIndexes */
+  zimIds: string[];
 }
 
 export class Search {
-  getResults(start: number, maxResults: number): SearchResultSet;
+  getResults(
+    start: number,
+    maxResults: number,
+    options?: SearchResultIncludeOptions,
+  ): SearchResultSet;
+  getResultsColumnar(start: number, maxResults: number): ColumnarSearchResults;
+  cursor(options?: SearchCursorOptions): SearchCursor;
   get estimatedMatches(): number;
 }
 
+/**
+ * timeoutMs bounds each next(), signal cancels every next() still pending;
+ * the page of a cancelled next() is skipped.
+ */
+export interface SearchCursorOptions extends AsyncOptions, CancelOptions {
+  pageSize?: number;
+  prefetch?: boolean;
+  /**
+   * generate the snippets with the pages, on the executor (default true);
+   * with false, reading one blocks, see SearchIterator.snippet
+   */
+  snippets?: boolean;
+}
+
+export class SearchCursor implements AsyncIterableIterator<SearchResultSet> {
+  next(): Promise<IteratorResult<SearchResultSet, undefined>>;
+  return(): Promise<IteratorResult<SearchResultSet, undefined>>;
+  [Symbol.asyncIterator](): SearchCursor;
+  get position(): number;
+  get pageSize(): number;
+}
+
+export interface CancelOptions {
+  signal?: AbortSignal;
+  timeoutMs?: number;
+}
+
+/** Negative or non-finite start / maxResults throw a RangeError. */
+export interface SearchOptions extends AsyncOptions, CancelOptions {
+  start?: number;
+  maxResults?: number;
+  /**
+   * generate the snippets with the page, on the executor (default true);
+   * with false, reading one blocks, see SearchIterator.snippet
+   */
+  snippets?: boolean;
+}
+
+/** Negative limits throw a RangeError. */
+export interface ResultCacheOptions {
+  maxEntries?: number;
+  maxBytes?: number;
+}
+
+export interface CacheStats {
+  entries: number;
+  bytes: number;
+  maxEntries: number;
+  maxBytes: number;
+  hits: number;
+  misses: number;
+  evictions: number;
+  hitRate: number;
+}
+
+export interface FederatedSearchOptions extends AsyncOptions, CancelOptions {
+  k?: number;
+  /**
+   * One finite, non-negative weight per archive, RangeError otherwise.
+   * Scores are not normalised across archives: each is a percentage of the
+   * best match of its own archive, so every archive's top hit scores about
+   * 100 and the weights alone rank one archive over another.
+   */
+  weights?: number[];
+  snippets?: boolean;
+}
+
+export interface FederatedHit {
+  path: string;
+  title: string;
+  score: number;
+  weightedScore: number;
+  wordCount: number;
+  fileIndex: number;
+  zimId: string;
+  snippet?: string;
+}
+
+export interface SearchManyQuery {
+  query: string | Query;
+  start?: number;
+  max?: number;
+  /** as in SearchOptions, default true */
+  snippets?: boolean;
+}
+
 export class Searcher {
-  constructor(archives: Archive | Archive[]);
-  addArchive(archive: Archive): this;
+  constructor(
+    archives: Archive | ArchiveHandle | (Archive | ArchiveHandle)[],
+  );
+  addArchive(archive: Archive | ArchiveHandle): this;
   search(query: string | Query): Search;
+  searchAsync(
+    query: string | Query,
+    options?: SearchOptions,
+  ): Promise<SearchResultSet>;
   setVerbose(verbose: boolean): this;
+  searchMany(
+    queries: SearchManyQuery[],
+    options?: AsyncOptions & CancelOptions,
+  ): Promise<SearchResultSet[]>;
+  searchFederated(
+    query: string | Query,
+    options?: FederatedSearchOptions,
+  ): Promise<FederatedHit[]>;
+  countEstimated(
+    queries: (string | Query)[],
+    options?: { async?: false },
+  ): number[];
+  countEstimated(
+    queries: (string | Query)[],
+    options: AsyncOptions & CancelOptions & { async: true },
+  ): Promise<number[]>;
+  setResultCache(options: ResultCacheOptions | boolean): this;
+  getResultCacheStats(): CacheStats;
+  clearResultCache(): this;
+}
+
+export interface SearcherPoolOptions {
+  size?: number;
+}
+
+export interface SearcherPoolStats {
+  size: number;
+  busy: number;
+  waiting: number;
+  saturation: number;
+  submitted: number;
+  completed: number;
+  failed: number;
+  avgWaitMs: number;
+  maxWaitMs: number;
+  avgLatencyMs: number;
+  maxLatencyMs: number;
+}
+
+/**
+ * Each searcher of the pool opens the archives again from their file, so
+ * that they have Xapian databases of their own and search in parallel.
+ * Archives opened from a file descriptor are shared, their searches run one
+ * at a time.
+ */
+export class SearcherPool {
+  constructor(
+    archives: Archive | ArchiveHandle | (Archive | ArchiveHandle)[],
+    options?: SearcherPoolOptions,
+  );
+  get size(): number;
+  searchAsync(
+    query: string | Query,
+    options?: SearchOptions,
+  ): Promise<SearchResultSet>;
+  getStats(): SearcherPoolStats;
 }
 
 export class SuggestionIterator {
@@ -280,19 +676,137 @@ export class SuggestionIterator {
   get path(): string;
   get snippet(): string;
   get hasSnippet(): boolean;
+  /** @deprecated misspelled, use hasSnippet */
+  get haSnippet(): boolean;
 }
 
 export interface SuggestionResultSet extends Iterable<SuggestionIterator> {
   readonly size: number;
 }
 
+export interface SuggestionArrayOptions {
+  snippets?: boolean;
+  /** return {titles, paths, snippets?} instead of one object per hit */
+  columnar?: boolean;
+}
+
+export interface SuggestionColumns {
+  titles: string[];
+  paths: string[];
+  /** only with {snippets}, null where the hit has no snippet */
+  snippets?: (string | null)[];
+}
+
 export class SuggestionSearch {
   getResults(start: number, maxResults: number): SuggestionResultSet;
+  getResultsArray(
+    start: number,
+    maxResults: number,
+    options: SuggestionArrayOptions & { columnar: true },
+  ): SuggestionColumns;
+  getResultsArray(
+    start: number,
+    maxResults: number,
+    options?: SuggestionArrayOptions,
+  ): Suggestion[];
   get estimatedMatches(): number;
 }
 
+export interface Suggestion {
+  title: string;
+  path: string;
+  snippet?: string;
+}
+
+export interface SuggestOptions extends AsyncOptions, CancelOptions {
+  start?: number;
+  max?: number;
+  snippets?: boolean;
+}
+
+export interface AutocompleteBuildOptions {
+  topK?: number;
+  maxPrefixLength?: number;
+  /** "path<TAB>score" lines, higher scores rank first */
+  popularityFile?: string;
+  priority?: Priority;
+}
+
+export interface Completion {
+  title: string;
+  path: string;
+  index: number;
+}
+
+export class AutocompleteIndex {
+  static build(
+    archive: Archive | ArchiveHandle,
+    options?: AutocompleteBuildOptions,
+  ): Promise<AutocompleteIndex>;
+  static load(archive: Archive | ArchiveHandle, path: string): AutocompleteIndex;
+  /**
+   * Case insensitive (ASCII). Past maxPrefixLength characters, matches
+   * outside of the top-k entries of the first maxPrefixLength characters are
+   * only found when their title has the prefix's casing, lowercase,
+   * capitalized or title case.
+   */
+  complete(prefix: string, options?: { max?: number }): Completion[];
+  save(path: string): Promise<void>;
+  get topK(): number;
+  get maxPrefixLength(): number;
+  get nodeCount(): number;
+  get memoryBytes(): number;
+  get mapped(): boolean;
+}
+
+export interface FuzzySuggestOptions {
+  /** edit distance in bytes, 0 to 3 */
+  maxDistance?: number;
+  max?: number;
+  /** match the text against the beginning of the titles */
+  prefix?: boolean;
+  /** leading bytes that must match exactly, 1 by default */
+  fixedPrefix?: number;
+}
+
+export interface FuzzySuggestion {
+  title: string;
+  path: string;
+  index: number;
+  distance: number;
+}
+
+export class FuzzyTitleIndex {
+  static build(
+    archive: Archive | ArchiveHandle,
+    options?: AsyncOptions,
+  ): Promise<FuzzyTitleIndex>;
+  /**
+   * About 2ms per lookup on 2M titles with the default options, more with a
+   * larger maxDistance or more titles: sub-millisecond lookups are not
+   * reached on the largest archives. Pass async to keep them off the main
+   * thread.
+   */
+  suggest(
+    text: string,
+    options?: FuzzySuggestOptions & { async?: false },
+  ): FuzzySuggestion[];
+  suggest(
+    text: string,
+    options: FuzzySuggestOptions &
+      AsyncOptions &
+      CancelOptions & { async: true },
+  ): Promise<FuzzySuggestion[]>;
+  get size(): number;
+  get memoryBytes(): number;
+}
+
 export class SuggestionSearcher {
-  constructor(archives: Archive);
+  constructor(archives: Archive | ArchiveHandle);
   suggest(query: string): SuggestionSearch;
+  suggestAsync(query: string, options?: SuggestOptions): Promise<Suggestion[]>;
+  setResultCache(options: ResultCacheOptions | boolean): this;
+  getResultCacheStats(): CacheStats;
+  clearResultCache(): this;
   setVerbose(verbose: boolean): this;
 }
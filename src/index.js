@@ -2,6 +2,7 @@ import bindings from "bindings";
 
 export const {
   Archive,
+  ArchiveHandle,
   OpenConfig,
   Entry,
   IntegrityCheck,
@@ -9,8 +10,11 @@ export const {
   IllustrationInfo,
   Blob,
   Searcher,
+  SearcherPool,
   Query,
   SuggestionSearcher,
+  AutocompleteIndex,
+  FuzzyTitleIndex,
   Creator,
   StringProvider,
   FileProvider,
@@ -19,4 +23,7 @@ export const {
   getClusterCacheMaxSize,
   getClusterCacheCurrentSize,
   setClusterCacheMaxSize,
+  getDirectReadStats,
+  getExecutorStats,
+  setThreadPoolSize,
 } = bindings("zim_binding");
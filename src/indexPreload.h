@@ -0,0 +1,323 @@
+#pragma once
+
+#include <fcntl.h>
+#include <napi.h>
+#include <unistd.h>
+#include <zim/archive.h>
+#include <zim/search.h>
+#include <zim/suggestion.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "searchLock.h"
+
+/**
+ * Warms up the fulltext or title Xapian database of an archive.
+ *
+ * libzim has no API to walk the posting lists, but the databases are stored
+ * as plain (uncompressed) items of the archive. The item's range of the ZIM
+ * file is read sequentially so that its pages are in the OS page cache, then
+ * the database is opened through a Searcher / SuggestionSearcher. That one is
+ * kept and handed to the next Searcher / SuggestionSearcher built over this
+ * archive alone, for its synchronous calls. Its other searchers (async,
+ * cursors) share the opened database (see SearchLock); pools open the
+ * archive again, reading the pages the preload left in the cache.
+ */
+class IndexPreload {
+ public:
+  enum class Kind { Fulltext, Title };
+
+  // progress(phase, bytesRead, totalBytes), phase is "read" or "open"
+  using Progress =
+      std::function<void(const char *phase, uint64_t done, uint64_t total)>;
+
+  struct Result {
+    bool found = false;  // the database item was located and read
+    bool opened = false;
+    uint64_t bytesRead = 0;
+    uint64_t totalBytes = 0;
+    double elapsedMs = 0;
+  };
+
+  static constexpr uint64_t kChunkSize = 1 << 20;
+
+  /**
+   * stop() is polled between chunks, the read is abandoned as soon as it
+   * returns true.
+   */
+  static Result Run(const std::shared_ptr<zim::Archive> &archive, Kind kind,
+                    const Progress &progress,
+                    const std::function<bool()> &stop) {
+    const auto startedAt = std::chrono::steady_clock::now();
+    Result res;
+    const bool present = kind == Kind::Fulltext ? archive->hasFulltextIndex()
+                                                : archive->hasTitleIndex();
+    if (!present) {
+      return res;
+    }
+
+    auto item = find(*archive, kind);
+    if (item) {
+      res.found = true;
+      res.totalBytes = item->getSize();
+      read(*item, res, progress, stop);
+    }
+
+    if (!stop()) {
+      // a first query opens the database
+      if (kind == Kind::Fulltext) {
+        SearchLock lock({*archive});
+        std::shared_ptr<zim::Searcher> searcher;
+        {
+          std::lock_guard<SearchLock> db(lock);
+          searcher = std::make_shared<zim::Searcher>(*archive);
+          searcher->search(zim::Query("a")).getEstimatedMatches();
+        }
+        keep(archive, [&](Warm &warm) { std::swap(warm.searcher, searcher); });
+        // the one kept by an earlier preload, if any
+        std::lock_guard<SearchLock> db(lock);
+        searcher.reset();
+      } else {
+        auto searcher = std::make_shared<zim::SuggestionSearcher>(*archive);
+        searcher->suggest("a").getEstimatedMatches();
+        keep(archive, [&](Warm &warm) { warm.suggestionSearcher = searcher; });
+      }
+      res.opened = true;
+      progress("open", res.bytesRead, res.totalBytes);
+    }
+
+    res.elapsedMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - startedAt)
+                        .count();
+    return res;
+  }
+
+  static Napi::Object ToObject(Napi::Env env, const Result &res) {
+    auto obj = Napi::Object::New(env);
+    obj["found"] = Napi::Value::From(env, res.found);
+    obj["opened"] = Napi::Value::From(env, res.opened);
+    obj["bytesRead"] = Napi::Value::From(env, res.bytesRead);
+    obj["totalBytes"] = Napi::Value::From(env, res.totalBytes);
+    obj["elapsedMs"] = Napi::Value::From(env, res.elapsedMs);
+    return obj;
+  }
+
+  static Napi::Object ProgressObject(Napi::Env env, const std::string &phase,
+                                     uint64_t done, uint64_t total) {
+    auto obj = Napi::Object::New(env);
+    obj["phase"] = Napi::String::New(env, phase);
+    obj["bytesRead"] = Napi::Value::From(env, done);
+    obj["totalBytes"] = Napi::Value::From(env, total);
+    return obj;
+  }
+
+  /**
+   * The Searcher opened by the last fulltext preload of archive, nullptr if
+   * there is none or it has been taken already. Only one caller gets it, a
+   * zim::Searcher must not be shared between threads.
+   */
+  static std::shared_ptr<zim::Searcher> TakeSearcher(
+      const zim::Archive *archive) {
+    std::shared_ptr<zim::Searcher> res;
+    take(archive, [&](Warm &warm) { std::swap(res, warm.searcher); });
+    return res;
+  }
+
+  // TakeSearcher() for the title index
+  static std::shared_ptr<zim::SuggestionSearcher> TakeSuggestionSearcher(
+      const zim::Archive *archive) {
+    std::shared_ptr<zim::SuggestionSearcher> res;
+    take(archive,
+         [&](Warm &warm) { std::swap(res, warm.suggestionSearcher); });
+    return res;
+  }
+
+  /**
+   * Drops the searchers kept for archives that are gone. They hold copies of
+   * the archive, and with them its file and databases open.
+   */
+  static void Purge() {
+    std::lock_guard<std::mutex> lock(warmMutex());
+    purge();
+  }
+
+ private:
+  // searchers opened by a preload, until a searcher over the archive takes
+  // them or the archive is gone (see Purge())
+  struct Warm {
+    std::weak_ptr<zim::Archive> archive;
+    std::shared_ptr<SearchLock> lock;  // of the database of searcher
+    std::shared_ptr<zim::Searcher> searcher;
+    std::shared_ptr<zim::SuggestionSearcher> suggestionSearcher;
+  };
+
+  static std::mutex &warmMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::vector<Warm> &warmList() {
+    static std::vector<Warm> list;
+    return list;
+  }
+
+  static void keep(const std::shared_ptr<zim::Archive> &archive,
+                   const std::function<void(Warm &)> &set) {
+    std::lock_guard<std::mutex> lock(warmMutex());
+    purge();
+    auto &list = warmList();
+    for (auto &warm : list) {
+      if (warm.archive.lock() == archive) {
+        set(warm);
+        return;
+      }
+    }
+    list.push_back(Warm{
+        archive,
+        std::make_shared<SearchLock>(std::vector<zim::Archive>{*archive}),
+        nullptr, nullptr});
+    set(list.back());
+  }
+
+  // must be called with warmMutex() held
+  static void purge() {
+    auto &list = warmList();
+    for (auto &warm : list) {
+      if (warm.archive.expired() && warm.searcher != nullptr) {
+        // other copies of the archive may still search its database
+        std::lock_guard<SearchLock> db(*warm.lock);
+        warm.searcher.reset();
+      }
+    }
+    list.erase(
+        std::remove_if(list.begin(), list.end(),
+                       [](const Warm &warm) { return warm.archive.expired(); }),
+        list.end());
+  }
+
+  static void take(const zim::Archive *archive,
+                   const std::function<void(Warm &)> &get) {
+    std::lock_guard<std::mutex> lock(warmMutex());
+    purge();
+    for (auto &warm : warmList()) {
+      // lock() is null once the archive is gone, a new one at the same
+      // address never matches
+      if (warm.archive.lock().get() == archive) {
+        get(warm);
+        return;
+      }
+    }
+  }
+
+  /**
+   * The index items live in the X namespace (fulltext also in Z for old
+   * ZIMs); getEntryByPath() takes a path with its namespace for those. Not
+   * finding them only skips the read phase.
+   */
+  static std::optional<zim::Item> find(const zim::Archive &archive,
+                                       Kind kind) {
+    const std::vector<std::string> paths =
+        kind == Kind::Fulltext
+            ? std::vector<std::string>{"X/fulltext/xapian",
+                                       "Z//fulltextIndex/xapian"}
+            : std::vector<std::string>{"X/title/xapian"};
+    for (const auto &path : paths) {
+      if (archive.hasEntryByPath(path)) {
+        return archive.getEntryByPath(path).getItem(true);
+      }
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Reads the item's range of the ZIM file with pread() when libzim gives
+   * direct access to it, through getData() otherwise (a compressed cluster or
+   * an item split over several parts).
+   */
+  static void read(const zim::Item &item, Result &res,
+                   const Progress &progress,
+                   const std::function<bool()> &stop) {
+    const auto dai = item.getDirectAccessInformation();
+    int fd = -1;
+    if (dai.isValid()) {
+      fd = ::open(dai.filename.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    std::vector<char> buffer(fd < 0 ? 0 : kChunkSize);
+
+    while (res.bytesRead < res.totalBytes && !stop()) {
+      const auto len = std::min(kChunkSize, res.totalBytes - res.bytesRead);
+      if (fd < 0) {
+        item.getData(res.bytesRead, len);
+        res.bytesRead += len;
+      } else {
+        const auto n =
+            ::pread(fd, buffer.data(), len, dai.offset + res.bytesRead);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n <= 0) {
+          ::close(fd);
+          throw std::runtime_error(
+              std::string("Unable to read the index: ") +
+              (n < 0 ? std::strerror(errno) : "unexpected end of file"));
+        }
+        res.bytesRead += n;
+      }
+      progress("read", res.bytesRead, res.totalBytes);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+};
+
+/**
+ * onProgress callback of an async preload. The thread safe function is
+ * released when the last copy of the reporter goes away, whichever way the
+ * work ended.
+ */
+class IndexPreloadReporter {
+ public:
+  IndexPreloadReporter(Napi::Env env, const Napi::Value &callback)
+      : active_{callback.IsFunction()} {
+    if (active_) {
+      tsfn_ = Napi::ThreadSafeFunction::New(
+          env, callback.As<Napi::Function>(), "zim:preloadProgress", 0, 1);
+    }
+  }
+
+  IndexPreloadReporter(const IndexPreloadReporter &) = delete;
+  IndexPreloadReporter &operator=(const IndexPreloadReporter &) = delete;
+
+  ~IndexPreloadReporter() {
+    if (active_) {
+      tsfn_.Release();
+    }
+  }
+
+  void report(const char *phase, uint64_t done, uint64_t total) const {
+    if (!active_) {
+      return;
+    }
+    std::string name = phase;
+    tsfn_.NonBlockingCall(
+        [name, done, total](Napi::Env env, Napi::Function callback) {
+          callback.Call({IndexPreload::ProgressObject(env, name, done, total)});
+        });
+  }
+
+ private:
+  bool active_;
+  Napi::ThreadSafeFunction tsfn_;
+};
@@ -6,6 +6,8 @@
 #include <memory>
 
 #include "blob.h"
+#include "directReader.h"
+#include "executor.h"
 
 class Item : public Napi::ObjectWrap<Item> {
  public:
@@ -55,37 +57,11 @@ class Item : public Napi::ObjectWrap<Item> {
   Napi::Value getData(const Napi::CallbackInfo &info) {
     try {
       auto env = info.Env();
-      size_t offset = 0;
-
-      // load offset if defined and is Number or BigInt
-      if (info[0].IsBigInt()) {
-        offset = info[0].As<Napi::BigInt>().Uint64Value(nullptr);
-      } else if (info[0].IsNumber()) {
-        int64_t val = info[0].ToNumber().Int64Value();
-        if (val < 0) {
-          throw Napi::Error::New(env,
-                                 "Offset must be greater than or equal to 0");
-        }
-        offset = static_cast<size_t>(val);
-      }
+      const auto offset = offsetFrom(env, info[0]);
 
       // load size if defined and is Number or BigInt
       if (info.Length() > 1) {
-        size_t size;
-        if (info[1].IsBigInt()) {
-          size = info[1].As<Napi::BigInt>().Uint64Value(nullptr);
-        } else if (info[1].IsNumber()) {
-          int64_t val = info[1].ToNumber().Int64Value();
-          if (val < 0) {
-            throw Napi::Error::New(env,
-                                   "Size must be greater than or equal to 0");
-          }
-          size = static_cast<size_t>(val);
-        } else {  // fail here because the wrong type defaults to 0
-          throw Napi::Error::New(env, "Size must be an Number or BigInt");
-        }
-
-        auto blob = item_->getData(offset, size);
+        auto blob = item_->getData(offset, sizeFrom(env, info[1]));
         return Blob::New(env, blob);
       }
 
@@ -96,6 +72,53 @@ class Item : public Napi::ObjectWrap<Item> {
     }
   }
 
+  // getDataAsync([offset], [size], [options]) runs in the interactive lane by
+  // default
+  Napi::Value getDataAsync(const Napi::CallbackInfo &info) {
+    try {
+      auto env = info.Env();
+      const auto offset = offsetFrom(env, info[0]);
+      const auto size = info.Length() > 1 && !info[1].IsUndefined() &&
+                                !info[1].IsObject()
+                            ? sizeFrom(env, info[1])
+                            : item_->getSize() - std::min<zim::size_type>(
+                                                     offset, item_->getSize());
+      const auto priority =
+          Executor::priorityFrom(env, info[info.Length() - 1],
+                                 Executor::Priority::Interactive);
+
+      auto item = item_;
+      return ExecutorPromiseWorker<zim::Blob>::Run(
+          env, priority,
+          [item, offset, size]() { return item->getData(offset, size); },
+          [](Napi::Env env, zim::Blob &blob) { return Blob::New(env, blob); });
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * Reads the item data on the DirectReader threads and resolves with a
+   * Buffer. Uncompressed items are read with pread straight from the file
+   * given by getDirectAccessInformation(), others go through getData().
+   */
+  Napi::Value readDirect(const Napi::CallbackInfo &info) {
+    try {
+      auto env = info.Env();
+      const auto offset = offsetFrom(env, info[0]);
+      const auto size = info.Length() > 1 && !info[1].IsUndefined()
+                            ? sizeFrom(env, info[1])
+                            : item_->getSize();
+
+      auto req = new DirectReadRequest(env, *item_, offset, size);
+      auto promise = req->Promise();
+      DirectReader::instance().submit(req);
+      return promise;
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
   Napi::Value getSize(const Napi::CallbackInfo &info) {
     try {
       return Napi::Value::From(info.Env(), item_->getSize());
@@ -137,6 +160,8 @@ class Item : public Napi::ObjectWrap<Item> {
                         InstanceAccessor<&Item::getMimetype>("mimetype"),
                         InstanceAccessor<&Item::getData>("data"),
                         InstanceMethod<&Item::getData>("getData"),
+                        InstanceMethod<&Item::getDataAsync>("getDataAsync"),
+                        InstanceMethod<&Item::readDirect>("readDirect"),
                         InstanceAccessor<&Item::getSize>("size"),
                         InstanceAccessor<&Item::getDirectAccessInformation>(
                             "directAccessInformation"),
@@ -148,5 +173,34 @@ class Item : public Napi::ObjectWrap<Item> {
   }
 
  private:
+  // load offset if defined and is Number or BigInt, defaults to 0
+  static zim::offset_type offsetFrom(Napi::Env env, const Napi::Value &value) {
+    if (value.IsBigInt()) {
+      return value.As<Napi::BigInt>().Uint64Value(nullptr);
+    } else if (value.IsNumber()) {
+      int64_t val = value.ToNumber().Int64Value();
+      if (val < 0) {
+        throw Napi::Error::New(env,
+                               "Offset must be greater than or equal to 0");
+      }
+      return static_cast<zim::offset_type>(val);
+    }
+    return 0;
+  }
+
+  static zim::size_type sizeFrom(Napi::Env env, const Napi::Value &value) {
+    if (value.IsBigInt()) {
+      return value.As<Napi::BigInt>().Uint64Value(nullptr);
+    } else if (value.IsNumber()) {
+      int64_t val = value.ToNumber().Int64Value();
+      if (val < 0) {
+        throw Napi::Error::New(env, "Size must be greater than or equal to 0");
+      }
+      return static_cast<zim::size_type>(val);
+    }
+    // fail here because the wrong type defaults to 0
+    throw Napi::Error::New(env, "Size must be an Number or BigInt");
+  }
+
   std::shared_ptr<zim::Item> item_;
 };
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <napi.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Limits from setResultCache() options: {maxEntries, maxBytes}, a missing one
+ * takes its default, true for both defaults, false to disable. Negative
+ * limits throw a RangeError.
+ */
+inline std::pair<size_t, size_t> cacheLimitsFrom(Napi::Env env,
+                                                 const Napi::Value &value,
+                                                 size_t defaultEntries,
+                                                 size_t defaultBytes) {
+  const auto limit = [&](const Napi::Object &obj, const std::string &name,
+                         size_t fallback) -> size_t {
+    if (!obj.Has(name)) {
+      return fallback;
+    }
+    const auto number = obj.Get(name).ToNumber().DoubleValue();
+    if (!(number >= 0)) {
+      throw Napi::RangeError::New(env, name + " must not be negative");
+    }
+    return static_cast<size_t>(
+        std::min(number, static_cast<double>(SIZE_MAX)));
+  };
+
+  if (value.IsObject()) {
+    auto obj = value.As<Napi::Object>();
+    return {limit(obj, "maxEntries", defaultEntries),
+            limit(obj, "maxBytes", defaultBytes)};
+  }
+  if (value.ToBoolean()) {
+    return {defaultEntries, defaultBytes};
+  }
+  return {0, 0};
+}
+
+/**
+ * Least recently used cache bounded both by entry count and by (estimated)
+ * bytes. A limit of 0 disables the cache.
+ *
+ * clear() starts a new generation: values computed from state older than a
+ * clear() are dropped by put() when given the generation they started in.
+ */
+template <typename ValueT>
+class LruCache {
+ public:
+  LruCache(size_t maxEntries, size_t maxBytes)
+      : maxEntries_{maxEntries},
+        maxBytes_{maxBytes},
+        bytes_{0},
+        hits_{0},
+        misses_{0},
+        evictions_{0},
+        generation_{0} {}
+
+  std::optional<ValueT> get(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      misses_++;
+      return std::nullopt;
+    }
+    hits_++;
+    items_.splice(items_.begin(), items_, it->second);
+    return it->second->value;
+  }
+
+  uint64_t generation() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+  }
+
+  // value is dropped if the cache was cleared since generation
+  void put(const std::string &key, ValueT value, size_t bytes,
+           std::optional<uint64_t> generation = std::nullopt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (generation && *generation != generation_) {
+      return;
+    }
+    bytes += key.size();
+    if (maxEntries_ == 0 || bytes > maxBytes_) {
+      return;
+    }
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      bytes_ -= it->second->bytes;
+      items_.erase(it->second);
+      index_.erase(it);
+    }
+    items_.push_front(Node{key, std::move(value), bytes});
+    index_[key] = items_.begin();
+    bytes_ += bytes;
+    evict();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.clear();
+    index_.clear();
+    bytes_ = 0;
+    generation_++;
+  }
+
+  void setLimits(size_t maxEntries, size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxEntries_ = maxEntries;
+    maxBytes_ = maxBytes;
+    evict();
+  }
+
+  bool enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxEntries_ > 0 && maxBytes_ > 0;
+  }
+
+  Napi::Object stats(Napi::Env env) const {
+    auto res = Napi::Object::New(env);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto lookups = hits_ + misses_;
+    res["entries"] = Napi::Value::From(env, items_.size());
+    res["bytes"] = Napi::Value::From(env, bytes_);
+    res["maxEntries"] = Napi::Value::From(env, maxEntries_);
+    res["maxBytes"] = Napi::Value::From(env, maxBytes_);
+    res["hits"] = Napi::Value::From(env, hits_);
+    res["misses"] = Napi::Value::From(env, misses_);
+    res["evictions"] = Napi::Value::From(env, evictions_);
+    res["hitRate"] = Napi::Value::From(
+        env, lookups > 0 ? static_cast<double>(hits_) / lookups : 0.0);
+    return res;
+  }
+
+ private:
+  struct Node {
+    std::string key;
+    ValueT value;
+    size_t bytes;
+  };
+
+  // must be called with mutex_ held
+  void evict() {
+    while (!items_.empty() &&
+           (items_.size() > maxEntries_ || bytes_ > maxBytes_)) {
+      auto &last = items_.back();
+      bytes_ -= last.bytes;
+      index_.erase(last.key);
+      items_.pop_back();
+      evictions_++;
+    }
+  }
+
+  mutable std::mutex mutex_;
+  std::list<Node> items_;
+  std::unordered_map<std::string, typename std::list<Node>::iterator> index_;
+  size_t maxEntries_;
+  size_t maxBytes_;
+  size_t bytes_;
+  uint64_t hits_;
+  uint64_t misses_;
+  uint64_t evictions_;
+  uint64_t generation_;
+};
@@ -1,16 +1,24 @@
 
 #include <napi.h>
 
+#include <algorithm>
+
 #include "archive.h"
+#include "archiveHandle.h"
+#include "autocomplete.h"
 #include "blob.h"
 #include "common.h"
 #include "contentProvider.h"
 #include "creator.h"
+#include "directReader.h"
 #include "entry.h"
+#include "executor.h"
+#include "fuzzyTitles.h"
 #include "illustration.h"
 #include "item.h"
 #include "openconfig.h"
 #include "search.h"
+#include "searcherPool.h"
 #include "suggestion.h"
 #include "writerItem.h"
 
@@ -28,12 +36,15 @@ Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
   Item::Init(env, exports, *constructors);
   Entry::Init(env, exports, *constructors);
   Archive::Init(env, exports, *constructors);
+  ArchiveHandle::Init(env, exports, *constructors);
   OpenConfig::Init(env, exports, *constructors);
   IllustrationInfo::Init(env, exports, *constructors);
 
   Searcher::Init(env, exports, *constructors);
+  SearcherPool::Init(env, exports, *constructors);
   Query::Init(env, exports, *constructors);
   Search::Init(env, exports, *constructors);
+  SearchCursor::Init(env, exports, *constructors);
   SearchResultSet::Init(env, exports, *constructors);
   SearchIterator::Init(env, exports, *constructors);
 
@@ -41,6 +52,8 @@ Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
   SuggestionSearch::Init(env, exports, *constructors);
   SuggestionResultSet::Init(env, exports, *constructors);
   SuggestionIterator::Init(env, exports, *constructors);
+  AutocompleteIndex::Init(env, exports, *constructors);
+  FuzzyTitleIndex::Init(env, exports, *constructors);
 
   StringProvider::Init(env, exports, *constructors);
   FileProvider::Init(env, exports, *constructors);
@@ -70,6 +83,28 @@ Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
                 auto size = info[0].As<Napi::Number>().Int64Value();
                 zim::setClusterCacheMaxSize(size);
               }));
+  exports.Set("getDirectReadStats",
+              Napi::Function::New(env, [](const Napi::CallbackInfo &info) {
+                return DirectReader::instance().stats(info.Env());
+              }));
+  exports.Set("setThreadPoolSize",
+              Napi::Function::New(env, [](const Napi::CallbackInfo &info) {
+                if (info.Length() < 1 || !info[0].IsNumber()) {
+                  throw Napi::TypeError::New(
+                      info.Env(),
+                      "First argument must be a number for pool size.");
+                }
+                try {
+                  auto size = info[0].As<Napi::Number>().Int64Value();
+                  Executor::instance().setSize(std::max<int64_t>(size, 0));
+                } catch (const std::exception &err) {
+                  throw Napi::RangeError::New(info.Env(), err.what());
+                }
+              }));
+  exports.Set("getExecutorStats",
+              Napi::Function::New(env, [](const Napi::CallbackInfo &info) {
+                return Executor::instance().stats(info.Env());
+              }));
 
   return exports;
 }
@@ -3,16 +3,189 @@
 #include <napi.h>
 #include <zim/search.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <deque>
 #include <exception>
 #include <functional>
+#include <iomanip>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "archive.h"
+#include "archiveHandle.h"
+#include "cancellation.h"
 #include "common.h"
 #include "entry.h"
+#include "entryListing.h"
+#include "executor.h"
+#include "lruCache.h"
+#include "searchLock.h"
+#include "snippet.h"
+
+/**
+ * Serializes use of the Xapian databases of a searcher's archives and of the
+ * searches / result sets created from it, see SearchLock. Every searcher
+ * over an archive shares its database, so the main thread waits for a query
+ * running on the executor over the same archive: for a sync search(), a
+ * snippet that was not collected with its page, or a page it drops.
+ */
+using SearchMutex = std::shared_ptr<SearchLock>;
+
+// TODO(kelvinhammond): convert this to static_cast<std::string>(uuid) This
+// didn't work when building because of the below error undefined symbol:
+// _ZNK3zim4UuidcvNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEEEv
+inline std::string zimIdString(const zim::Uuid &uuid) {
+  std::ostringstream out;
+  out << uuid;
+  return out.str();
+}
+
+/**
+ * A zim::Searcher of its own, rebuilt when an ArchiveHandle behind it has
+ * been swapped. With reopen, the archives are opened again from their file
+ * so that their Xapian databases are not shared with any other searcher;
+ * archives without a file name (opened from a file descriptor) are shared.
+ */
+struct SearcherHandle {
+  std::shared_ptr<std::mutex> mutex;  // guards the members below
+  std::shared_ptr<zim::Searcher> searcher;
+  ArchiveSet archives;
+  std::vector<zim::Archive> snapshot;  // the archives searcher was built on
+  SearchMutex lock;                    // of their databases
+  bool reopen = false;
+
+  ~SearcherHandle() { drop(); }
+
+  // must be called with mutex held, the searcher is used under lock
+  zim::Searcher &current() {
+    if (searcher == nullptr || archives.stale()) {
+      drop();
+      snapshot = archives.snapshot();
+      if (reopen) {
+        for (auto &archive : snapshot) {
+          if (!archive.getFilename().empty()) {
+            archive = zim::Archive(archive.getFilename());
+          }
+        }
+      }
+      lock = std::make_shared<SearchLock>(snapshot);
+      searcher = std::make_shared<zim::Searcher>(snapshot);
+    }
+    return *searcher;
+  }
+
+  void drop() {
+    if (searcher != nullptr) {
+      std::lock_guard<SearchLock> db(*lock);
+      searcher.reset();
+    }
+  }
+};
+
+/**
+ * A page of search results with the hit fields Xapian holds copied out
+ * while the page is built, under the lock of the database it comes from.
+ * The title and the entry take a dirent lookup, they are resolved from the
+ * archive on first read instead. Only snippets not collected up front are
+ * generated later, under that lock again.
+ */
+struct SearchPage {
+  struct Hit {
+    zim::SearchIterator it;  // only for late snippets, use under mutex
+    std::string path;
+    int score;
+    int wordCount;
+    int fileIndex;
+    std::string zimId;
+    std::optional<std::string> snippet;
+    mutable std::optional<zim::Entry> entry;  // set by SearchPage::entry()
+  };
+
+  SearchPage(zim::SearchResultSet results, SearchMutex mutex,
+             std::vector<zim::Archive> archives, std::vector<Hit> hits)
+      : results{std::move(results)},
+        mutex{std::move(mutex)},
+        archives{std::move(archives)},
+        hits{std::move(hits)} {}
+
+  SearchPage(const SearchPage &) = delete;
+  SearchPage &operator=(const SearchPage &) = delete;
+
+  // the iterators share the Xapian database of other searchers
+  ~SearchPage() {
+    std::lock_guard<SearchLock> lock(*mutex);
+    hits.clear();
+    results.reset();
+  }
+
+  std::optional<zim::SearchResultSet> results;  // owner of the iterators
+  SearchMutex mutex;
+  std::vector<zim::Archive> archives;  // of the searcher, by file index
+  std::vector<Hit> hits;
+
+  // must be called with mutex held
+  static std::shared_ptr<SearchPage> Collect(
+      zim::SearchResultSet results, SearchMutex mutex,
+      std::vector<zim::Archive> archives, bool snippets) {
+    std::vector<Hit> hits;
+    for (auto it = results.begin(); it != results.end(); it++) {
+      std::optional<std::string> snippet;
+      if (snippets) {
+        snippet = it.getSnippet();
+      }
+      hits.push_back(Hit{it, it.getPath(), it.getScore(), it.getWordCount(),
+                         it.getFileIndex(), zimIdString(it.getZimId()),
+                         std::move(snippet), std::nullopt});
+    }
+    return std::make_shared<SearchPage>(std::move(results), std::move(mutex),
+                                        std::move(archives), std::move(hits));
+  }
+
+  // pages are read on the main thread only, which fills the entry cache
+  const zim::Entry &entry(size_t i) const {
+    const auto &hit = hits[i];
+    if (!hit.entry) {
+      hit.entry = archives.at(hit.fileIndex).getEntryByPath(hit.path);
+    }
+    return *hit.entry;
+  }
+
+  std::string snippet(size_t i) const {
+    const auto &hit = hits[i];
+    if (hit.snippet) {
+      return *hit.snippet;
+    }
+    std::lock_guard<SearchLock> lock(*mutex);
+    return hit.it.getSnippet();
+  }
+
+  // estimated memory use, for the cache limits
+  size_t bytes() const {
+    size_t bytes = sizeof(*this);
+    for (const auto &hit : hits) {
+      bytes += kHitBytes + hit.path.size() +
+               (hit.snippet ? hit.snippet->size() : 0);
+    }
+    return bytes;
+  }
+
+ private:
+  // Xapian MSet item and document kept alive by a hit, and its entry
+  static constexpr size_t kHitBytes = 512;
+};
 
 class Query : public Napi::ObjectWrap<Query> {
  public:
@@ -139,89 +312,80 @@ class Query : public Napi::ObjectWrap<Query> {
   std::shared_ptr<zim::Query> query_;
 };
 
+/**
+ * One hit of a SearchPage. The title and entry are resolved by the page on
+ * first read, a snippet that was not collected with it is generated then.
+ */
 class SearchIterator : public Napi::ObjectWrap<SearchIterator> {
  public:
   explicit SearchIterator(const Napi::CallbackInfo &info)
-      : Napi::ObjectWrap<SearchIterator>(info), searchIterator_{} {
-    if (info[0].IsExternal()) {
-      searchIterator_ =
-          *info[0].As<Napi::External<zim::SearchIterator>>().Data();
+      : Napi::ObjectWrap<SearchIterator>(info), page_{nullptr}, index_{0} {
+    if (!info[0].IsExternal()) {
+      throw Napi::Error::New(info.Env(),
+                             "SearchIterator must be created internally.");
     }
+    page_ = *info[0].As<Napi::External<decltype(page_)>>().Data();
+    index_ = info[1].ToNumber().Uint32Value();
   }
 
-  static Napi::Object New(Napi::Env env, zim::SearchIterator iterator) {
-    auto external = Napi::External<zim::SearchIterator>::New(env, &iterator);
+  static Napi::Object New(Napi::Env env,
+                          std::shared_ptr<const SearchPage> page,
+                          size_t index) {
+    auto external = Napi::External<decltype(page)>::New(env, &page);
     auto &constructor =
         env.GetInstanceData<ModuleConstructors>()->searchIterator;
-    return constructor.New({external});
+    return constructor.New({external, Napi::Value::From(env, index)});
   }
 
   Napi::Value getPath(const Napi::CallbackInfo &info) {
-    try {
-      return Napi::Value::From(info.Env(), searchIterator_.getPath());
-    } catch (const std::exception &err) {
-      throw Napi::Error::New(info.Env(), err.what());
-    }
+    return Napi::Value::From(info.Env(), hit().path);
   }
 
   Napi::Value getTitle(const Napi::CallbackInfo &info) {
     try {
-      return Napi::Value::From(info.Env(), searchIterator_.getTitle());
+      return Napi::Value::From(info.Env(), page_->entry(index_).getTitle());
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
     }
   }
 
   Napi::Value getScore(const Napi::CallbackInfo &info) {
-    try {
-      return Napi::Value::From(info.Env(), searchIterator_.getScore());
-    } catch (const std::exception &err) {
-      throw Napi::Error::New(info.Env(), err.what());
-    }
+    return Napi::Value::From(info.Env(), hit().score);
   }
 
   Napi::Value getSnippet(const Napi::CallbackInfo &info) {
     try {
-      return Napi::Value::From(info.Env(), searchIterator_.getSnippet());
+      return Napi::Value::From(info.Env(), page_->snippet(index_));
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
     }
   }
 
-  Napi::Value getWordCount(const Napi::CallbackInfo &info) {
+  // the snippet as {text, highlights}, see StructuredSnippet
+  Napi::Value getStructuredSnippet(const Napi::CallbackInfo &info) {
     try {
-      return Napi::Value::From(info.Env(), searchIterator_.getWordCount());
+      return StructuredSnippet::Parse(page_->snippet(index_))
+          .ToObject(info.Env());
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
     }
   }
 
+  Napi::Value getWordCount(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), hit().wordCount);
+  }
+
   Napi::Value getFileIndex(const Napi::CallbackInfo &info) {
-    try {
-      return Napi::Value::From(info.Env(), searchIterator_.getFileIndex());
-    } catch (const std::exception &err) {
-      throw Napi::Error::New(info.Env(), err.what());
-    }
+    return Napi::Value::From(info.Env(), hit().fileIndex);
   }
 
   Napi::Value getZimId(const Napi::CallbackInfo &info) {
-    try {
-      // TODO(kelvinhammond): convert this to
-      // static_cast<std::string>(archive_->getUuid()) This didn't work when
-      // building because of the below error undefined symbol:
-      // _ZNK3zim4UuidcvNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEEEv
-      std::ostringstream out;
-      out << searchIterator_.getZimId();
-      return Napi::Value::From(info.Env(), out.str());
-    } catch (const std::exception &err) {
-      throw Napi::Error::New(info.Env(), err.what());
-    }
+    return Napi::Value::From(info.Env(), hit().zimId);
   }
 
   Napi::Value getEntry(const Napi::CallbackInfo &info) {
     try {
-      auto iterator = zim::Entry(*searchIterator_);
-      return Entry::New(info.Env(), std::move(iterator));
+      return Entry::New(info.Env(), zim::Entry(page_->entry(index_)));
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
     }
@@ -236,6 +400,8 @@ class SearchIterator : public Napi::ObjectWrap<SearchIterator> {
             InstanceAccessor<&SearchIterator::getTitle>("title"),
             InstanceAccessor<&SearchIterator::getScore>("score"),
             InstanceAccessor<&SearchIterator::getSnippet>("snippet"),
+            InstanceAccessor<&SearchIterator::getStructuredSnippet>(
+                "structuredSnippet"),
             InstanceAccessor<&SearchIterator::getWordCount>("wordCount"),
             InstanceAccessor<&SearchIterator::getFileIndex>("fileIndex"),
             InstanceAccessor<&SearchIterator::getZimId>("zimId"),
@@ -247,13 +413,16 @@ class SearchIterator : public Napi::ObjectWrap<SearchIterator> {
   }
 
  private:
-  zim::SearchIterator searchIterator_;
+  const SearchPage::Hit &hit() const { return page_->hits[index_]; }
+
+  std::shared_ptr<const SearchPage> page_;
+  size_t index_;
 };
 
 class SearchResultSet : public Napi::ObjectWrap<SearchResultSet> {
  public:
   explicit SearchResultSet(const Napi::CallbackInfo &info)
-      : Napi::ObjectWrap<SearchResultSet>(info), searchResultSet_{nullptr} {
+      : Napi::ObjectWrap<SearchResultSet>(info), page_{nullptr}, include_{0} {
     Napi::Env env = info.Env();
 
     if (!info[0].IsExternal()) {
@@ -261,24 +430,42 @@ class SearchResultSet : public Napi::ObjectWrap<SearchResultSet> {
                              "SearchResultSet must be created internally.");
     }
 
-    searchResultSet_ =
-        *info[0].As<Napi::External<decltype(searchResultSet_)>>().Data();
+    page_ = *info[0].As<Napi::External<decltype(page_)>>().Data();
   }
 
+  /**
+   * include is a mask of extra toArray() fields (see includeFrom()) added to
+   * the default ones.
+   */
   static Napi::Object New(Napi::Env env,
-                          const zim::SearchResultSet &resultSet) {
-    // done this way to avoid copying the zim::SearchResultSet during creation
-    // also need to copy it to lose the const qualifier so just do it here.
-    auto ptr = std::make_shared<zim::SearchResultSet>(resultSet);
-    auto external = Napi::External<decltype(ptr)>::New(env, &ptr);
+                          std::shared_ptr<const SearchPage> page,
+                          uint32_t include = 0) {
+    auto external = Napi::External<decltype(page)>::New(env, &page);
     auto &constructor =
         env.GetInstanceData<ModuleConstructors>()->searchResultSet;
-    return constructor.New({external});
+    auto obj = constructor.New({external});
+    Unwrap(obj)->include_ = include;
+    return obj;
+  }
+
+  /**
+   * Mask of the fields listed in {include}: item fields (mimetype, size,
+   * isRedirect, redirectPath) or any other result field.
+   */
+  static uint32_t includeFrom(Napi::Env env, const Napi::Value &options) {
+    if (!options.IsObject()) {
+      return 0;
+    }
+    auto value = options.As<Napi::Object>().Get("include");
+    if (value.IsUndefined()) {
+      return 0;
+    }
+    return fieldListFrom(env, value, "include");
   }
 
   Napi::Value getSize(const Napi::CallbackInfo &info) {
     try {
-      return Napi::Value::From(info.Env(), searchResultSet_->size());
+      return Napi::Value::From(info.Env(), page_->hits.size());
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
     }
@@ -286,26 +473,23 @@ class SearchResultSet : public Napi::ObjectWrap<SearchResultSet> {
 
   Napi::Value getIterator(const Napi::CallbackInfo &info) {
     try {
-      auto range = searchResultSet_;
+      auto page = page_;
       return Napi::Function::New(
-          info.Env(), [range](const Napi::CallbackInfo &info) -> Napi::Value {
+          info.Env(), [page](const Napi::CallbackInfo &info) -> Napi::Value {
             Napi::Env env = info.Env();
             Napi::Object iter = Napi::Object::New(env);
 
-            auto it = range->begin();
+            size_t i = 0;
             iter["next"] = Napi::Function::New(
                 info.Env(),
-                [it,
-                 range](const Napi::CallbackInfo &info) mutable -> Napi::Value {
+                [i, page](const Napi::CallbackInfo &info) mutable
+                -> Napi::Value {
                   Napi::Env env = info.Env();
                   Napi::Object res = Napi::Object::New(env);
-
-                  if (it != range->end()) {
+                  if (i < page->hits.size()) {
                     res["done"] = false;
-                    // This only returns the entry and loses info
-                    // res["value"] = Entry::New(env, zim::Entry(*it));
-                    res["value"] = SearchIterator::New(env, it);
-                    it++;
+                    res["value"] = SearchIterator::New(env, page, i);
+                    i++;
                   } else {
                     res["done"] = true;
                   }
@@ -318,12 +502,59 @@ class SearchResultSet : public Napi::ObjectWrap<SearchResultSet> {
     }
   }
 
+  /**
+   * toArray([{fields, include, snippets}]) builds plain result objects in
+   * one pass. fields defaults to every field but the snippet and the item
+   * fields, which include adds (along with the include given to getResults).
+   * The snippet is only generated when listed or when snippets is set,
+   * snippets: 'structured' returns {text, highlights} instead of HTML.
+   */
+  Napi::Value toArray(const Napi::CallbackInfo &info) {
+    try {
+      auto env = info.Env();
+      const auto fields = fieldsFrom(env, info[0]);
+
+      const auto &hits = page_->hits;
+      auto res = Napi::Array::New(env, hits.size());
+      for (size_t i = 0; i < hits.size(); i++) {
+        const auto &hit = hits[i];
+        auto obj = Napi::Object::New(env);
+        if (fields & kPath) obj["path"] = hit.path;
+        if (fields & kTitle) obj["title"] = page_->entry(i).getTitle();
+        if (fields & kScore) {
+          obj["score"] = Napi::Value::From(env, hit.score);
+        }
+        if (fields & kStructured) {
+          obj["snippet"] =
+              StructuredSnippet::Parse(page_->snippet(i)).ToObject(env);
+        } else if (fields & kSnippet) {
+          obj["snippet"] = page_->snippet(i);
+        }
+        if (fields & kWordCount) {
+          obj["wordCount"] = Napi::Value::From(env, hit.wordCount);
+        }
+        if (fields & kFileIndex) {
+          obj["fileIndex"] = Napi::Value::From(env, hit.fileIndex);
+        }
+        if (fields & kZimId) obj["zimId"] = hit.zimId;
+        if (fields & EntryListing::kItemFields) {
+          EntryListing::SetItemFields(env, obj, page_->entry(i), fields);
+        }
+        res.Set(i, obj);
+      }
+      return res;
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
   static void Init(Napi::Env env, Napi::Object exports,
                    ModuleConstructors &constructors) {
     Napi::Function func =
         DefineClass(env, "SearchResultSet",
                     {
                         InstanceAccessor<&SearchResultSet::getSize>("size"),
+                        InstanceMethod<&SearchResultSet::toArray>("toArray"),
                         InstanceAccessor<&SearchResultSet::getIterator>(
                             Napi::Symbol::WellKnown(env, "iterator")),
                     });
@@ -333,28 +564,424 @@ class SearchResultSet : public Napi::ObjectWrap<SearchResultSet> {
   }
 
  private:
-  std::shared_ptr<zim::SearchResultSet> searchResultSet_;
+  // the item fields keep the bits of EntryListing, which writes them
+  enum Field : uint32_t {
+    kMimetype = EntryListing::kMimetype,
+    kSize = EntryListing::kSize,
+    kIsRedirect = EntryListing::kIsRedirect,
+    kRedirectPath = EntryListing::kRedirectPath,
+    kPath = 1 << 8,
+    kTitle = 1 << 9,
+    kScore = 1 << 10,
+    kSnippet = 1 << 11,
+    kWordCount = 1 << 12,
+    kFileIndex = 1 << 13,
+    kZimId = 1 << 14,
+    kStructured = 1 << 15,  // snippet as StructuredSnippet
+  };
+
+  static uint32_t fieldListFrom(Napi::Env env, const Napi::Value &value,
+                                const std::string &option) {
+    static const EntryListing::FieldNames names = {
+        {"path", kPath},
+        {"title", kTitle},
+        {"score", kScore},
+        {"snippet", kSnippet},
+        {"wordCount", kWordCount},
+        {"fileIndex", kFileIndex},
+        {"zimId", kZimId},
+        {"mimetype", kMimetype},
+        {"size", kSize},
+        {"isRedirect", kIsRedirect},
+        {"redirectPath", kRedirectPath},
+    };
+    return EntryListing::MaskFrom(env, value, names, option, "result");
+  }
+
+  uint32_t fieldsFrom(Napi::Env env, const Napi::Value &options) const {
+    uint32_t fields =
+        kPath | kTitle | kScore | kWordCount | kFileIndex | kZimId;
+    fields |= include_;
+    if (!options.IsObject()) {
+      return fields;
+    }
+
+    auto obj = options.As<Napi::Object>();
+    auto value = obj.Get("fields");
+    if (!value.IsUndefined()) {
+      fields = fieldListFrom(env, value, "fields") | include_;
+    }
+    fields |= includeFrom(env, options);
+
+    auto snippets = obj.Get("snippets");
+    if (snippets.IsString()) {
+      const auto format = snippets.ToString().Utf8Value();
+      if (format == "structured") {
+        fields |= kSnippet | kStructured;
+      } else if (format == "html") {
+        fields |= kSnippet;
+      } else {
+        throw Napi::TypeError::New(env, "Unknown snippet format: " + format);
+      }
+    } else if (snippets.ToBoolean()) {
+      fields |= kSnippet;
+    }
+    return fields;
+  }
+
+  std::shared_ptr<const SearchPage> page_;
+  uint32_t include_;
+};
+
+/**
+ * Pages of a search served one after the other, with the next page fetched on
+ * the background lane while the current one is being used.
+ *
+ * The cursor runs its query again on the executor's searcher of the
+ * Searcher (the Search it comes from belongs to the main thread) and keeps
+ * that zim::Search, so every page reuses its Xapian enquire. The prefetched
+ * page lives in a single slot and no executor thread ever waits for it: the
+ * task of a next() whose page is being prefetched is held back until the
+ * prefetch is done, a queued prefetch is taken over so it never waits on a
+ * busy executor.
+ */
+class SearchCursorState
+    : public std::enable_shared_from_this<SearchCursorState> {
+ public:
+  SearchCursorState(std::shared_ptr<SearcherHandle> handle, zim::Query query,
+                    size_t pageSize, bool snippets)
+      : handle_{std::move(handle)},
+        query_{std::move(query)},
+        pageSize_{pageSize},
+        snippets_{snippets},
+        done_{false} {}
+
+  ~SearchCursorState() {
+    if (search_ != nullptr) {
+      std::lock_guard<SearchLock> db(*lock_);
+      search_.reset();
+    }
+  }
+
+  size_t pageSize() const { return pageSize_; }
+
+  // set on the main thread once a short page was returned
+  bool done() const { return done_; }
+  void setDone() { done_ = true; }
+
+  // ExecutorSubmitFunc of next(start), see schedule()
+  ExecutorSubmitFunc submitter(size_t start) {
+    auto self = shared_from_this();
+    return [self, start](Executor::Priority priority,
+                         std::function<void()> task) {
+      self->schedule(start, priority, std::move(task));
+    };
+  }
+
+  // must run from a task given to schedule()
+  std::shared_ptr<SearchPage> fetch(size_t start) {
+    std::unique_lock<std::mutex> lock(slotMutex_);
+    if (slot_ && slot_->start == start &&
+        slot_->state == Slot::State::Ready) {
+      auto slot = std::move(*slot_);
+      slot_.reset();
+      if (slot.error) {
+        std::rethrow_exception(slot.error);
+      }
+      return std::move(slot.results);
+    }
+    lock.unlock();
+    return query(start);
+  }
+
+  void prefetch(size_t start) {
+    {
+      std::lock_guard<std::mutex> lock(slotMutex_);
+      if (slot_ && slot_->state == Slot::State::Running) {
+        return;
+      }
+      slot_.emplace();
+      slot_->start = start;
+    }
+
+    auto self = shared_from_this();
+    Executor::instance().submit(Executor::Priority::Background,
+                                [self, start]() { self->runPrefetch(start); });
+  }
+
+ private:
+  struct Parked {
+    Executor::Priority priority;
+    std::function<void()> task;
+  };
+
+  struct Slot {
+    enum class State { Queued, Running, Ready };
+    size_t start;
+    State state = State::Queued;
+    std::shared_ptr<SearchPage> results;
+    std::exception_ptr error;
+    std::vector<Parked> waiting;  // next() tasks held back until Ready
+  };
+
+  /**
+   * Submits the task of next(start), called on the main thread. A running
+   * prefetch of that page keeps the task until it is done, a queued one is
+   * dropped so that fetch() runs the query itself.
+   */
+  void schedule(size_t start, Executor::Priority priority,
+                std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(slotMutex_);
+      if (slot_ && slot_->start == start) {
+        if (slot_->state == Slot::State::Running) {
+          slot_->waiting.push_back(Parked{priority, std::move(task)});
+          return;
+        }
+        if (slot_->state == Slot::State::Queued) {
+          slot_.reset();
+        }
+      }
+    }
+    Executor::instance().submit(priority, std::move(task));
+  }
+
+  void runPrefetch(size_t start) {
+    {
+      std::lock_guard<std::mutex> lock(slotMutex_);
+      if (!slot_ || slot_->start != start ||
+          slot_->state != Slot::State::Queued) {
+        return;  // taken over by next() or replaced
+      }
+      slot_->state = Slot::State::Running;
+    }
+
+    std::shared_ptr<SearchPage> results;
+    std::exception_ptr error;
+    try {
+      results = query(start);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    // a running slot is neither replaced nor taken over
+    std::vector<Parked> waiting;
+    {
+      std::lock_guard<std::mutex> lock(slotMutex_);
+      slot_->results = std::move(results);
+      slot_->error = error;
+      slot_->state = Slot::State::Ready;
+      waiting.swap(slot_->waiting);
+    }
+    for (auto &parked : waiting) {
+      Executor::instance().submit(parked.priority, std::move(parked.task));
+    }
+  }
+
+  std::shared_ptr<SearchPage> query(size_t start) {
+    std::lock_guard<std::mutex> lock(*handle_->mutex);
+    if (search_ == nullptr) {
+      auto &searcher = handle_->current();
+      lock_ = handle_->lock;
+      archives_ = handle_->snapshot;
+      std::lock_guard<SearchLock> db(*lock_);
+      search_ = std::make_unique<zim::Search>(searcher.search(query_));
+    }
+    std::lock_guard<SearchLock> db(*lock_);
+    return SearchPage::Collect(search_->getResults(start, pageSize_), lock_,
+                               archives_, snippets_);
+  }
+
+  std::shared_ptr<SearcherHandle> handle_;
+  zim::Query query_;
+  std::unique_ptr<zim::Search> search_;  // guarded by handle_->mutex
+  SearchMutex lock_;                     // of the archives search_ was run on
+  std::vector<zim::Archive> archives_;
+  size_t pageSize_;
+  bool snippets_;
+  bool done_;
+  std::mutex slotMutex_;
+  std::optional<Slot> slot_;
+};
+
+/**
+ * Async iterator over the pages of a Search, {done, value: SearchResultSet}.
+ */
+class SearchCursor : public Napi::ObjectWrap<SearchCursor> {
+ public:
+  explicit SearchCursor(const Napi::CallbackInfo &info)
+      : Napi::ObjectWrap<SearchCursor>(info),
+        state_{nullptr},
+        position_{0},
+        prefetch_{true},
+        priority_{Executor::Priority::Interactive} {
+    if (!info[0].IsExternal()) {
+      throw Napi::Error::New(info.Env(),
+                             "SearchCursor must be created internally.");
+    }
+    state_ = *info[0].As<Napi::External<decltype(state_)>>().Data();
+  }
+
+  static Napi::Object New(Napi::Env env,
+                          std::shared_ptr<SearchCursorState> state,
+                          bool prefetch, Executor::Priority priority,
+                          const Napi::Value &options) {
+    auto external = Napi::External<decltype(state)>::New(env, &state);
+    auto &constructor = env.GetInstanceData<ModuleConstructors>()->searchCursor;
+    auto obj = constructor.New({external});
+    auto cursor = Unwrap(obj);
+    cursor->prefetch_ = prefetch;
+    cursor->priority_ = priority;
+    if (options.IsObject()) {
+      cursor->options_ = Napi::Persistent(options.As<Napi::Object>());
+    }
+    return obj;
+  }
+
+  /**
+   * next() resolves with the next page, {done: true} once a page comes back
+   * short. Calls made before the previous page resolved get the pages after
+   * it. The {signal, timeoutMs} of the cursor's options apply to every
+   * next(), a page whose next() was cancelled is skipped.
+   */
+  Napi::Value next(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    try {
+      if (state_->done()) {
+        auto deferred = Napi::Promise::Deferred::New(env);
+        deferred.Resolve(iteratorResult(env, env.Undefined(), true));
+        return deferred.Promise();
+      }
+
+      const size_t start = position_;
+      const size_t pageSize = state_->pageSize();
+      position_ += pageSize;
+      auto state = state_;
+      auto cancellation = Cancellation::From(
+          env, options_.IsEmpty() ? env.Undefined() : options_.Value());
+      auto promise = ExecutorPromiseWorker<std::shared_ptr<SearchPage>>::Run(
+          env, priority_, [state, start]() { return state->fetch(start); },
+          [state, pageSize](Napi::Env env, std::shared_ptr<SearchPage> &page) {
+            const auto size = page->hits.size();
+            if (size < pageSize) {
+              state->setDone();
+            }
+            if (size == 0) {
+              return iteratorResult(env, env.Undefined(), true);
+            }
+            return iteratorResult(
+                env, SearchResultSet::New(env, page), false);
+          },
+          cancellation, state->submitter(start));
+      if (prefetch_) {
+        state_->prefetch(position_);
+      }
+      return promise;
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
+  // return() ends the iteration, for `break` in a for await loop
+  Napi::Value finish(const Napi::CallbackInfo &info) {
+    state_->setDone();
+    auto env = info.Env();
+    auto deferred = Napi::Promise::Deferred::New(env);
+    deferred.Resolve(iteratorResult(env, env.Undefined(), true));
+    return deferred.Promise();
+  }
+
+  Napi::Value getAsyncIterator(const Napi::CallbackInfo &info) {
+    return info.This();
+  }
+
+  Napi::Value getPosition(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), position_);
+  }
+
+  Napi::Value getPageSize(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), state_->pageSize());
+  }
+
+  static void Init(Napi::Env env, Napi::Object exports,
+                   ModuleConstructors &constructors) {
+    Napi::Function func = DefineClass(
+        env, "SearchCursor",
+        {
+            InstanceMethod<&SearchCursor::next>("next"),
+            InstanceMethod<&SearchCursor::finish>("return"),
+            InstanceMethod<&SearchCursor::getAsyncIterator>(
+                Napi::Symbol::WellKnown(env, "asyncIterator")),
+            InstanceAccessor<&SearchCursor::getPosition>("position"),
+            InstanceAccessor<&SearchCursor::getPageSize>("pageSize"),
+        });
+
+    exports.Set("SearchCursor", func);
+    constructors.searchCursor = Napi::Persistent(func);
+  }
+
+ private:
+  static Napi::Object iteratorResult(Napi::Env env, Napi::Value value,
+                                     bool done) {
+    auto res = Napi::Object::New(env);
+    res["done"] = Napi::Boolean::New(env, done);
+    res["value"] = value;
+    return res;
+  }
+
+  std::shared_ptr<SearchCursorState> state_;
+  size_t position_;
+  bool prefetch_;
+  Executor::Priority priority_;
+  Napi::ObjectReference options_;  // {signal, timeoutMs} of every next()
 };
 
 class Search : public Napi::ObjectWrap<Search> {
  public:
   explicit Search(const Napi::CallbackInfo &info)
-      : Napi::ObjectWrap<Search>(info), search_{nullptr} {
+      : Napi::ObjectWrap<Search>(info), search_{nullptr}, mutex_{nullptr} {
     if (!info[0].IsExternal()) {
       throw Napi::Error::New(info.Env(), "Search must be created internally.");
     }
 
     search_ = std::make_shared<zim::Search>(
         std::move(*info[0].As<Napi::External<zim::Search>>().Data()));
+    mutex_ = *info[1].As<Napi::External<SearchMutex>>().Data();
   }
 
-  static Napi::Object New(Napi::Env env, zim::Search search) {
+  // the search shares the Xapian databases of other searchers
+  ~Search() {
+    if (search_ != nullptr) {
+      std::lock_guard<SearchLock> lock(*mutex_);
+      search_.reset();
+    }
+  }
+
+  /**
+   * search runs on the main thread under mutex; cursors run query again on
+   * the executor's handle.
+   */
+  static Napi::Object New(Napi::Env env, zim::Search search,
+                          SearchMutex mutex,
+                          std::vector<zim::Archive> archives,
+                          zim::Query query,
+                          std::shared_ptr<SearcherHandle> handle) {
     // NOTE: search will be std::move into a shared_ptr and invalid after this.
     auto external = Napi::External<zim::Search>::New(env, &search);
+    auto mutexExternal = Napi::External<SearchMutex>::New(env, &mutex);
     auto &constructor = env.GetInstanceData<ModuleConstructors>()->search;
-    return constructor.New({external});
+    auto obj = constructor.New({external, mutexExternal});
+    auto self = Unwrap(obj);
+    self->archives_ = std::move(archives);
+    self->query_ = std::move(query);
+    self->handle_ = std::move(handle);
+    return obj;
   }
 
+  /**
+   * getResults(start, maxResults, [{include}]) where include lists extra
+   * fields (mimetype, size, isRedirect, redirectPath) for toArray().
+   */
   Napi::Value getResults(const Napi::CallbackInfo &info) {
     try {
       // TODO(kelvinhammond): construct SearchResultSet and return
@@ -367,14 +994,112 @@ class Search : public Napi::ObjectWrap<Search> {
 
       auto start = info[0].ToNumber();
       auto maxResults = info[1].ToNumber();
-      return SearchResultSet::New(env, search_->getResults(start, maxResults));
+      const auto include = SearchResultSet::includeFrom(env, info[2]);
+      std::lock_guard<SearchLock> lock(*mutex_);
+      return SearchResultSet::New(
+          env,
+          SearchPage::Collect(search_->getResults(start, maxResults), mutex_,
+                              archives_, false),
+          include);
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
     }
   }
 
+  /**
+   * getResultsColumnar(start, maxResults) returns the hits as parallel typed
+   * arrays: entry indexes, scores and file indexes, plus the zim id of every
+   * archive the search was run on, by file index.
+   */
+  Napi::Value getResultsColumnar(const Napi::CallbackInfo &info) {
+    try {
+      auto env = info.Env();
+      if (!(info[0].IsNumber() && info[1].IsNumber())) {
+        throw Napi::Error::New(env,
+                               "getResultsColumnar must be called with start "
+                               "and maxResults values of type Number");
+      }
+
+      auto start = info[0].ToNumber();
+      auto maxResults = info[1].ToNumber();
+      std::lock_guard<SearchLock> lock(*mutex_);
+      auto results = search_->getResults(start, maxResults);
+      const auto size = static_cast<size_t>(results.size());
+      auto entryIndexes = Napi::Uint32Array::New(env, size);
+      auto scores = Napi::Float32Array::New(env, size);
+      auto fileIndexes = Napi::Uint16Array::New(env, size);
+
+      size_t i = 0;
+      for (auto it = results.begin(); it != results.end() && i < size; it++) {
+        entryIndexes[i] = it->getIndex();
+        scores[i] = static_cast<float>(it.getScore());
+        fileIndexes[i] = static_cast<uint16_t>(it.getFileIndex());
+        i++;
+      }
+
+      auto ids = Napi::Array::New(env, archives_.size());
+      for (size_t j = 0; j < archives_.size(); j++) {
+        ids.Set(j, Napi::String::New(env, zimIdString(archives_[j].getUuid())));
+      }
+
+      auto res = Napi::Object::New(env);
+      res["entryIndexes"] = entryIndexes;
+      res["scores"] = scores;
+      res["fileIndexes"] = fileIndexes;
+      res["zimIds"] = ids;
+      return res;
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * cursor([{pageSize, prefetch, snippets, priority, signal, timeoutMs}])
+   * pages through the results with next() / for await, fetching the
+   * following page in the background unless prefetch is false. Snippets are
+   * generated along with the pages, on the executor, unless snippets is
+   * false. timeoutMs bounds each next(), signal cancels them all.
+   */
+  Napi::Value cursor(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    // outside of the try, so a TypeError keeps its type
+    Cancellation::From(env, info[0]);
+    try {
+      size_t pageSize = kDefaultPageSize;
+      bool prefetch = true;
+      bool snippets = true;
+      if (info[0].IsObject()) {
+        auto options = info[0].As<Napi::Object>();
+        if (options.Has("pageSize")) {
+          auto value = options.Get("pageSize");
+          if (!value.IsNumber() || value.ToNumber().Int64Value() < 1) {
+            throw Napi::RangeError::New(env,
+                                        "pageSize must be a positive number");
+          }
+          pageSize = value.ToNumber().Int64Value();
+        }
+        if (options.Has("prefetch")) {
+          prefetch = options.Get("prefetch").ToBoolean();
+        }
+        if (options.Has("snippets")) {
+          snippets = options.Get("snippets").ToBoolean();
+        }
+      }
+      const auto priority = Executor::priorityFrom(
+          env, info[0], Executor::Priority::Interactive);
+      return SearchCursor::New(
+          env,
+          std::make_shared<SearchCursorState>(handle_, query_, pageSize,
+                                              snippets),
+          prefetch, priority, info[0]);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(env, err.what());
+    }
+  }
+
   Napi::Value getEstimatedMatches(const Napi::CallbackInfo &info) {
     try {
+      std::lock_guard<SearchLock> lock(*mutex_);
       return Napi::Value::From(info.Env(), search_->getEstimatedMatches());
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
@@ -387,6 +1112,8 @@ class Search : public Napi::ObjectWrap<Search> {
         env, "Search",
         {
             InstanceMethod<&Search::getResults>("getResults"),
+            InstanceMethod<&Search::getResultsColumnar>("getResultsColumnar"),
+            InstanceMethod<&Search::cursor>("cursor"),
             InstanceAccessor<&Search::getEstimatedMatches>("estimatedMatches"),
         });
 
@@ -395,45 +1122,333 @@ class Search : public Napi::ObjectWrap<Search> {
   }
 
  private:
+  static constexpr size_t kDefaultPageSize = 10;
+
   std::shared_ptr<zim::Search> search_;
+  SearchMutex mutex_;
+  std::vector<zim::Archive> archives_;  // search_ was run on
+  zim::Query query_;
+  std::shared_ptr<SearcherHandle> handle_;
 };
 
-class Searcher : public Napi::ObjectWrap<Searcher> {
+/**
+ * One hit of a federated search, copied out of Xapian on the executor.
+ */
+struct FederatedHit {
+  std::string path;
+  std::string title;
+  std::string snippet;
+  std::string zimId;
+  int score;
+  double weightedScore;
+  int wordCount;
+  uint32_t fileIndex;
+};
+
+/**
+ * Weighted scores of the best hits found so far by a federated search. Once
+ * k of them are known, archives (or further hits) that cannot beat the k-th
+ * one are skipped.
+ */
+class FederatedTopK {
  public:
-  explicit Searcher(const Napi::CallbackInfo &info)
-      : Napi::ObjectWrap<Searcher>(info), searcher_{nullptr} {
-    Napi::Env env = info.Env();
+  explicit FederatedTopK(size_t k) : k_{k} {}
 
-    if (info[0].IsArray()) {
-      auto array = info[0].As<Napi::Array>();
-      if (array.Length() < 1) {
-        throw Napi::Error::New(
-            env, "Searcher: argument array must contain at least 1 archive.");
+  // true when no hit of an archive with this weight can enter the top k
+  bool decided(double weight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return best_.size() >= k_ && best_.top() >= kMaxScore * weight;
+  }
+
+  // records a hit, returns false if it does not enter the top k
+  bool add(double weightedScore) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (best_.size() < k_) {
+      best_.push(weightedScore);
+      return true;
+    }
+    if (weightedScore <= best_.top()) {
+      return false;
+    }
+    best_.pop();
+    best_.push(weightedScore);
+    return true;
+  }
+
+ private:
+  // libzim scores are percentages
+  static constexpr double kMaxScore = 100;
+
+  std::mutex mutex_;
+  size_t k_;
+  std::priority_queue<double, std::vector<double>, std::greater<double>> best_;
+};
+
+/**
+ * Page of results requested from an async search: {start, maxResults,
+ * snippets}. Snippets are generated with the page unless snippets is false:
+ * generating one later takes the lock of the archives' databases on the
+ * main thread.
+ */
+struct SearchWindow {
+  uint32_t start = 0;
+  uint32_t maxResults = 10;
+  bool snippets = true;
+
+  // throws a RangeError, call it outside of a try so it keeps its type
+  static SearchWindow From(Napi::Env env, const Napi::Value &options) {
+    SearchWindow window;
+    if (options.IsObject()) {
+      auto obj = options.As<Napi::Object>();
+      window.start = CountFrom(env, obj, "start", window.start);
+      window.maxResults = CountFrom(env, obj, "maxResults", window.maxResults);
+      auto snippets = obj.Get("snippets");
+      if (!snippets.IsUndefined()) {
+        window.snippets = snippets.ToBoolean();
       }
+    }
+    return window;
+  }
 
-      std::vector<zim::Archive> archives;
-      for (size_t i = 0; i < array.Length(); i++) {
-        auto obj = array.Get(i);
-        if (!obj.IsObject()) {
-          throw Napi::Error::New(
-              env, "Searcher: array arguments must be Archive objects");
-        }
+  /**
+   * options[name] as a count, fallback when not set. Negative, non-finite
+   * and too large values throw a RangeError instead of wrapping around.
+   */
+  static uint32_t CountFrom(Napi::Env env, const Napi::Object &options,
+                            const std::string &name, uint32_t fallback) {
+    auto value = options.Get(name);
+    if (value.IsUndefined()) {
+      return fallback;
+    }
+    const auto count = value.ToNumber().DoubleValue();
+    if (!std::isfinite(count) || count < 0 ||
+        count > std::numeric_limits<uint32_t>::max()) {
+      throw Napi::RangeError::New(env,
+                                  name + " must be a non-negative number");
+    }
+    return static_cast<uint32_t>(count);
+  }
+};
+
+/**
+ * Searchers of a SearcherPool (or of Searcher.searchMany) and their usage
+ * counters. Shared with the searches in flight so the pool object may be
+ * collected before they end.
+ *
+ * Searches are handed to the executor through schedule(), which holds them
+ * back while every searcher is busy: a task on an executor thread always
+ * finds a free searcher and never parks the thread.
+ */
+class SearcherPoolState
+    : public std::enable_shared_from_this<SearcherPoolState> {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Holds a member for the duration of one search
+  class Lease {
+   public:
+    Lease(SearcherPoolState &state, Clock::time_point queuedAt)
+        : state_{state}, idx_{state.acquire(queuedAt)}, failed_{true} {}
+
+    ~Lease() { state_.release(idx_, failed_); }
+
+    SearcherHandle &member() { return state_.members_[idx_]; }
+    void succeeded() { failed_ = false; }
+
+   private:
+    SearcherPoolState &state_;
+    size_t idx_;
+    bool failed_;
+  };
+
+  SearcherPoolState(const ArchiveSet &archives, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      // searchers are built on first use, on the executor
+      members_.push_back(SearcherHandle{std::make_shared<std::mutex>(),
+                                        nullptr, archives, {}, nullptr, true});
+      free_.push_back(i);
+    }
+    acquiredAt_.resize(size);
+  }
+
+  size_t size() const { return members_.size(); }
+
+  Napi::Object stats(Napi::Env env) {
+    auto res = Napi::Object::New(env);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto size = members_.size();
+    const auto busy = size - free_.size();
+    res["size"] = Napi::Value::From(env, size);
+    res["busy"] = Napi::Value::From(env, busy);
+    res["waiting"] = Napi::Value::From(env, parked_.size());
+    res["saturation"] =
+        Napi::Value::From(env, static_cast<double>(busy) / size);
+    res["submitted"] = Napi::Value::From(env, submitted_);
+    res["completed"] = Napi::Value::From(env, completed_);
+    res["failed"] = Napi::Value::From(env, failed_);
+    res["avgWaitMs"] = Napi::Value::From(
+        env, acquired_ > 0 ? totalWaitNs_ / 1e6 / acquired_ : 0.0);
+    res["maxWaitMs"] = Napi::Value::From(env, maxWaitNs_ / 1e6);
+    const auto done = completed_ + failed_;
+    res["avgLatencyMs"] = Napi::Value::From(
+        env, done > 0 ? totalLatencyNs_ / 1e6 / done : 0.0);
+    res["maxLatencyMs"] = Napi::Value::From(env, maxLatencyNs_ / 1e6);
+    return res;
+  }
+
+  void submitted() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    submitted_++;
+  }
+
+  using Page = std::shared_ptr<SearchPage>;
+
+  // ExecutorSubmitFunc of the searches, see schedule()
+  ExecutorSubmitFunc submitter() {
+    auto self = shared_from_this();
+    return [self](Executor::Priority priority, std::function<void()> task) {
+      self->schedule(priority, std::move(task));
+    };
+  }
+
+  /**
+   * Runs one query on a free searcher. Must run from a task given to
+   * schedule(), which guarantees there is one.
+   */
+  Page search(Clock::time_point queuedAt, const zim::Query &query,
+              const SearchWindow &window) {
+    Lease lease(*this, queuedAt);
+    auto &member = lease.member();
+    std::lock_guard<std::mutex> lock(*member.mutex);
+    auto &searcher = member.current();
+    std::lock_guard<SearchLock> db(*member.lock);
+    auto search = searcher.search(query);
+    auto page = SearchPage::Collect(
+        search.getResults(window.start, window.maxResults), member.lock,
+        member.snapshot, window.snippets);
+    lease.succeeded();
+    return page;
+  }
+
+ private:
+  static uint64_t elapsedNs(Clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                since)
+        .count();
+  }
 
-        auto archive = Napi::ObjectWrap<Archive>::Unwrap(obj.As<Napi::Object>())
-                           ->archive();
-        archives.emplace_back(*archive);
+  struct Parked {
+    Executor::Priority priority;
+    std::function<void()> task;
+  };
+
+  void schedule(Executor::Priority priority, std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (admitted_ >= members_.size()) {
+        parked_.push_back(Parked{priority, std::move(task)});
+        return;
       }
+      admitted_++;
+    }
+    submit(priority, std::move(task));
+  }
+
+  void submit(Executor::Priority priority, std::function<void()> task) {
+    auto self = shared_from_this();
+    Executor::instance().submit(priority, [self, task = std::move(task)]() {
+      task();
+      self->finished();
+    });
+  }
+
+  // an admitted task is done, the next parked one takes its place
+  void finished() {
+    std::optional<Parked> next;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (parked_.empty()) {
+        admitted_--;
+        return;
+      }
+      next.emplace(std::move(parked_.front()));
+      parked_.pop_front();
+    }
+    submit(next->priority, std::move(next->task));
+  }
+
+  size_t acquire(Clock::time_point queuedAt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+      throw std::logic_error("search run outside of SearcherPoolState");
+    }
+
+    const auto idx = free_.front();
+    free_.pop_front();
+    const auto wait = elapsedNs(queuedAt);
+    acquired_++;
+    totalWaitNs_ += wait;
+    maxWaitNs_ = std::max(maxWaitNs_, wait);
+    acquiredAt_[idx] = Clock::now();
+    return idx;
+  }
 
-      searcher_ = std::make_shared<zim::Searcher>(archives);
-    } else if (info[0].IsObject()) {  // one archive
-      auto archive =
-          Napi::ObjectWrap<Archive>::Unwrap(info[0].As<Napi::Object>())
-              ->archive();
-      searcher_ = std::make_shared<zim::Searcher>(*archive);
+  void release(size_t idx, bool failed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto latency = elapsedNs(acquiredAt_[idx]);
+    totalLatencyNs_ += latency;
+    maxLatencyNs_ = std::max(maxLatencyNs_, latency);
+    if (failed) {
+      failed_++;
     } else {
-      throw Napi::Error::New(env,
-                             "Searcher: argument 1 must be an Archive object "
-                             "or an array of Archive objects.");
+      completed_++;
+    }
+    free_.push_back(idx);
+  }
+
+  std::vector<SearcherHandle> members_;
+
+  std::mutex mutex_;
+  std::deque<size_t> free_;
+  std::vector<Clock::time_point> acquiredAt_;
+  // tasks on the executor, at most one per searcher, and the ones held back
+  size_t admitted_ = 0;
+  std::deque<Parked> parked_;
+  uint64_t submitted_ = 0;
+  uint64_t completed_ = 0;
+  uint64_t failed_ = 0;
+  uint64_t acquired_ = 0;
+  uint64_t totalWaitNs_ = 0;
+  uint64_t maxWaitNs_ = 0;
+  uint64_t totalLatencyNs_ = 0;
+  uint64_t maxLatencyNs_ = 0;
+};
+
+class Searcher : public Napi::ObjectWrap<Searcher> {
+ public:
+  explicit Searcher(const Napi::CallbackInfo &info)
+      : Napi::ObjectWrap<Searcher>(info),
+        searcher_{nullptr},
+        archives_{ArchiveHandle::archiveSetFrom(info.Env(), info[0],
+                                                "Searcher")},
+        verbose_{false},
+        mutex_{nullptr},
+        async_{nullptr},
+        cache_{std::make_shared<LruCache<std::shared_ptr<SearchPage>>>(0, 0)},
+        pool_{nullptr},
+        federation_{nullptr} {
+    try {
+      searcher();
+      async_ = newAsyncHandle();
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  ~Searcher() {
+    if (searcher_ != nullptr) {
+      std::lock_guard<SearchLock> lock(*mutex_);
+      searcher_.reset();
     }
   }
 
@@ -444,10 +1459,24 @@ class Searcher : public Napi::ObjectWrap<Searcher> {
                                "argument 1 must be an Archive object.");
       }
 
-      auto archive =
-          Napi::ObjectWrap<Archive>::Unwrap(info[0].As<Napi::Object>())
-              ->archive();
-      searcher_->addArchive(*archive);
+      auto slot = ArchiveHandle::slotFrom(info.Env(),
+                                          info[0].As<Napi::Object>());
+      auto searcher = this->searcher();
+      auto snapshot = snapshot_;
+      snapshot.push_back(*slot->archive());
+      auto mutex = std::make_shared<SearchLock>(snapshot);
+      {
+        std::lock_guard<SearchLock> lock(*mutex);
+        searcher->addArchive(*slot->archive());
+      }
+      snapshot_ = std::move(snapshot);
+      mutex_ = std::move(mutex);
+      archives_.add(slot);
+      // dropped pages and handles take the lock of their databases
+      async_ = newAsyncHandle();
+      cache_->clear();
+      pool_ = nullptr;
+      federation_ = nullptr;
       return info.This();
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
@@ -457,28 +1486,360 @@ class Searcher : public Napi::ObjectWrap<Searcher> {
   Napi::Value search(const Napi::CallbackInfo &info) {
     try {
       auto env = info.Env();
-      if (info[0].IsString()) {
-        // coerce to query
-        auto &&query = zim::Query(info[0].ToString().Utf8Value());
-        auto &&search = searcher_->search(query);
-        return Search::New(env, std::move(search));
-      } else if (info[0].IsObject()) {
-        auto &&query =
-            Napi::ObjectWrap<Query>::Unwrap(info[0].As<Napi::Object>())
-                ->query();
-        auto &&search = searcher_->search(*query);
-        return Search::New(env, std::move(search));
-      }
-
-      throw Napi::Error::New(env, "search argument must be a query or string");
+      auto query = queryFrom(env, info[0]);
+      auto searcher = this->searcher();
+      std::lock_guard<SearchLock> lock(*mutex_);
+      auto &&search = searcher->search(query);
+      return Search::New(env, std::move(search), mutex_, snapshot_, query,
+                         async_);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * searchAsync(query, [{start, maxResults, snippets, priority, signal,
+   * timeoutMs}]) runs the query and fetches the requested page on the
+   * executor's database handle, resolving with a SearchResultSet. Snippets
+   * are generated there too unless snippets is false. Pages found in the
+   * result cache resolve right away.
+   */
+  Napi::Value searchAsync(const Napi::CallbackInfo &info) {
+    // outside of the try, so a RangeError keeps its type
+    const auto window = SearchWindow::From(info.Env(), info[1]);
+    try {
+      auto env = info.Env();
+      auto query = queryFrom(env, info[0]);
+      const auto priority = Executor::priorityFrom(
+          env, info[1], Executor::Priority::Interactive);
+      auto cancellation = Cancellation::From(env, info[1]);
+
+      // clears the cache when an archive handle was swapped
+      this->searcher();
+      auto handle = async_;
+      auto cache = cache_;
+      // a page of archives replaced before it is done must not be cached
+      const auto generation = cache->generation();
+      std::string key;
+      if (cache->enabled()) {
+        key = cacheKey(query, window);
+        if (auto cached = cache->get(key)) {
+          auto deferred = Napi::Promise::Deferred::New(env);
+          if (!cancellation ||
+              !cancellation->rejectIfExpired(env, deferred)) {
+            deferred.Resolve(SearchResultSet::New(env, *cached));
+          }
+          return deferred.Promise();
+        }
+      }
+
+      return ExecutorPromiseWorker<std::shared_ptr<SearchPage>>::Run(
+          env, priority,
+          [handle, query, window]() {
+            std::lock_guard<std::mutex> lock(*handle->mutex);
+            auto &searcher = handle->current();
+            std::lock_guard<SearchLock> db(*handle->lock);
+            auto search = searcher.search(query);
+            return SearchPage::Collect(
+                search.getResults(window.start, window.maxResults),
+                handle->lock, handle->snapshot, window.snippets);
+          },
+          [cache, key, generation](Napi::Env env,
+                                   std::shared_ptr<SearchPage> &page) {
+            if (!key.empty()) {
+              cache->put(key, page, page->bytes(), generation);
+            }
+            return SearchResultSet::New(env, page);
+          },
+          cancellation);
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
     }
   }
 
+  /**
+   * searchMany([{query, start, max, snippets}, ...], [{priority, signal,
+   * timeoutMs}]) runs the queries in parallel, each on its own database
+   * handle from a pool kept by this searcher, resolving with one
+   * SearchResultSet per query. Snippets come with the pages as in
+   * searchAsync().
+   */
+  Napi::Value searchMany(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    if (!info[0].IsArray()) {
+      throw Napi::Error::New(env, "searchMany requires an array of queries");
+    }
+    auto array = info[0].As<Napi::Array>();
+
+    // outside of the try, so a RangeError keeps its type
+    std::vector<SearchWindow> windows;
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      auto value = array.Get(i);
+      if (!value.IsObject()) {
+        throw Napi::Error::New(
+            env, "searchMany entries must be {query, start, max} objects");
+      }
+      auto obj = value.As<Napi::Object>();
+      auto window = SearchWindow::From(env, obj);
+      window.maxResults =
+          SearchWindow::CountFrom(env, obj, "max", window.maxResults);
+      windows.push_back(window);
+    }
+
+    try {
+      if (pool_ == nullptr) {
+        const auto size = std::max(2u, std::thread::hardware_concurrency());
+        pool_ = std::make_shared<SearcherPoolState>(archives_, size);
+      }
+
+      auto pool = pool_;
+      const auto queuedAt = SearcherPoolState::Clock::now();
+      std::vector<std::function<SearcherPoolState::Page()>> tasks;
+      for (uint32_t i = 0; i < array.Length(); i++) {
+        auto query =
+            queryFrom(env, array.Get(i).As<Napi::Object>().Get("query"));
+        const auto window = windows[i];
+        pool->submitted();
+        tasks.push_back([pool, queuedAt, query, window]() {
+          return pool->search(queuedAt, query, window);
+        });
+      }
+
+      const auto priority = Executor::priorityFrom(
+          env, info[1], Executor::Priority::Interactive);
+      return ExecutorBatchWorker<SearcherPoolState::Page>::Run(
+          env, priority, std::move(tasks),
+          [](Napi::Env env, std::vector<SearcherPoolState::Page> &pages) {
+            auto res = Napi::Array::New(env, pages.size());
+            for (size_t i = 0; i < pages.size(); i++) {
+              res.Set(i, SearchResultSet::New(env, pages[i]));
+            }
+            return res;
+          },
+          Cancellation::From(env, info[1]), pool->submitter());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * searchFederated(query, [{k, weights, snippets, priority, signal,
+   * timeoutMs}]) queries every archive separately and in parallel, and
+   * resolves with the k best hits by score * weight of their archive (1 by
+   * default). Each hit has the fileIndex and zimId of its archive.
+   *
+   * Xapian scores each archive on its own: a score is a percentage of the
+   * best match of that archive, so the top hit of every archive is near 100
+   * however well it matches. Scores are not normalised across archives; the
+   * weights are the only way to rank one archive over another.
+   */
+  Napi::Value searchFederated(const Napi::CallbackInfo &info) {
+    // outside of the try, so a RangeError keeps its type
+    const auto nbArchives = archives_.slots().size();
+    const auto weights = weightsFrom(info.Env(), info[1], nbArchives);
+    uint32_t k = 10;
+    if (info[1].IsObject()) {
+      k = SearchWindow::CountFrom(info.Env(), info[1].As<Napi::Object>(), "k",
+                                  k);
+    }
+    if (k < 1) {
+      throw Napi::RangeError::New(info.Env(), "k must be at least 1");
+    }
+    try {
+      auto env = info.Env();
+      auto query = queryFrom(env, info[0]);
+      bool snippets = false;
+      if (info[1].IsObject()) {
+        snippets = info[1].As<Napi::Object>().Get("snippets").ToBoolean();
+      }
+
+      if (federation_ == nullptr) {
+        federation_ = std::make_shared<std::vector<SearcherHandle>>();
+        for (const auto &slot : archives_.slots()) {
+          ArchiveSet archive;
+          archive.add(slot);
+          federation_->push_back(
+              SearcherHandle{std::make_shared<std::mutex>(), nullptr,
+                             std::move(archive), {}, nullptr});
+        }
+      }
+
+      // heaviest archives first, they are the most likely to decide the top k
+      std::vector<uint32_t> order(nbArchives);
+      for (uint32_t i = 0; i < nbArchives; i++) {
+        order[i] = i;
+      }
+      std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+        return weights[a] > weights[b];
+      });
+
+      auto federation = federation_;
+      auto topK = std::make_shared<FederatedTopK>(k);
+      std::vector<std::function<std::vector<FederatedHit>()>> tasks;
+      for (auto idx : order) {
+        const auto weight = weights[idx];
+        tasks.push_back([federation, topK, query, idx, weight, k, snippets]() {
+          std::vector<FederatedHit> hits;
+          if (topK->decided(weight)) {
+            return hits;
+          }
+
+          auto &handle = (*federation)[idx];
+          std::lock_guard<std::mutex> lock(*handle.mutex);
+          auto &searcher = handle.current();
+          std::lock_guard<SearchLock> db(*handle.lock);
+          auto results = searcher.search(query).getResults(0, k);
+          for (auto it = results.begin(); it != results.end(); it++) {
+            // hits come by decreasing score
+            const auto weighted = it.getScore() * weight;
+            if (!topK->add(weighted)) {
+              break;
+            }
+            hits.push_back(FederatedHit{
+                it.getPath(), it.getTitle(),
+                snippets ? it.getSnippet() : std::string(),
+                zimIdString(it.getZimId()), it.getScore(), weighted,
+                it.getWordCount(), idx});
+          }
+          return hits;
+        });
+      }
+
+      return ExecutorBatchWorker<std::vector<FederatedHit>>::Run(
+          env,
+          Executor::priorityFrom(env, info[1],
+                                 Executor::Priority::Interactive),
+          std::move(tasks),
+          [k, snippets](Napi::Env env,
+                        std::vector<std::vector<FederatedHit>> &perArchive) {
+            std::vector<FederatedHit> hits;
+            for (auto &archiveHits : perArchive) {
+              std::move(archiveHits.begin(), archiveHits.end(),
+                        std::back_inserter(hits));
+            }
+            std::stable_sort(hits.begin(), hits.end(),
+                             [](const auto &a, const auto &b) {
+                               return a.weightedScore > b.weightedScore;
+                             });
+            hits.resize(std::min<size_t>(hits.size(), k));
+
+            auto res = Napi::Array::New(env, hits.size());
+            for (size_t i = 0; i < hits.size(); i++) {
+              const auto &hit = hits[i];
+              auto obj = Napi::Object::New(env);
+              obj["path"] = hit.path;
+              obj["title"] = hit.title;
+              obj["score"] = Napi::Value::From(env, hit.score);
+              obj["weightedScore"] = Napi::Value::From(env, hit.weightedScore);
+              obj["wordCount"] = Napi::Value::From(env, hit.wordCount);
+              obj["fileIndex"] = Napi::Value::From(env, hit.fileIndex);
+              obj["zimId"] = hit.zimId;
+              if (snippets) obj["snippet"] = hit.snippet;
+              res.Set(i, obj);
+            }
+            return res;
+          },
+          Cancellation::From(env, info[1]));
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * countEstimated(queries, [{async, priority, signal, timeoutMs}]) returns
+   * the estimated match count of each query, or a promise of them when async
+   * is true. Only the estimate is computed (an empty Xapian page), no result
+   * is fetched.
+   */
+  Napi::Value countEstimated(const Napi::CallbackInfo &info) {
+    try {
+      auto env = info.Env();
+      if (!info[0].IsArray()) {
+        throw Napi::Error::New(env, "queries must be an array");
+      }
+
+      auto array = info[0].As<Napi::Array>();
+      std::vector<zim::Query> queries;
+      for (uint32_t i = 0; i < array.Length(); i++) {
+        queries.push_back(queryFrom(env, array.Get(i)));
+      }
+
+      auto toCounts = [queries](zim::Searcher &searcher) {
+        std::vector<int> counts;
+        for (const auto &query : queries) {
+          counts.push_back(searcher.search(query).getEstimatedMatches());
+        }
+        return counts;
+      };
+      auto toArray = [](Napi::Env env, std::vector<int> &counts) {
+        auto res = Napi::Array::New(env, counts.size());
+        for (size_t i = 0; i < counts.size(); i++) {
+          res.Set(i, Napi::Value::From(env, counts[i]));
+        }
+        return res;
+      };
+
+      const auto options = info[1];
+      if (options.IsObject() &&
+          options.As<Napi::Object>().Get("async").ToBoolean()) {
+        const auto priority = Executor::priorityFrom(
+            env, options, Executor::Priority::Interactive);
+        auto handle = async_;
+        return ExecutorPromiseWorker<std::vector<int>>::Run(
+            env, priority,
+            [handle, toCounts]() {
+              std::lock_guard<std::mutex> lock(*handle->mutex);
+              auto &searcher = handle->current();
+              std::lock_guard<SearchLock> db(*handle->lock);
+              return toCounts(searcher);
+            },
+            toArray, Cancellation::From(env, options));
+      }
+
+      auto searcher = this->searcher();
+      std::lock_guard<SearchLock> lock(*mutex_);
+      auto counts = toCounts(*searcher);
+      return toArray(env, counts);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * setResultCache({maxEntries, maxBytes}) enables the cache of searchAsync()
+   * pages, setResultCache(false) disables it. Memory use is estimated.
+   */
+  Napi::Value setResultCache(const Napi::CallbackInfo &info) {
+    // outside of the try, so a RangeError keeps its type
+    const auto [maxEntries, maxBytes] = cacheLimitsFrom(
+        info.Env(), info[0], kDefaultCacheEntries, kDefaultCacheBytes);
+    try {
+      cache_->setLimits(maxEntries, maxBytes);
+      return info.This();
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  Napi::Value getResultCacheStats(const Napi::CallbackInfo &info) {
+    try {
+      return cache_->stats(info.Env());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  Napi::Value clearResultCache(const Napi::CallbackInfo &info) {
+    cache_->clear();
+    return info.This();
+  }
+
   Napi::Value setVerbose(const Napi::CallbackInfo &info) {
     try {
-      searcher_->setVerbose(info[0].ToBoolean());
+      verbose_ = info[0].ToBoolean();
+      auto searcher = this->searcher();
+      std::lock_guard<SearchLock> lock(*mutex_);
+      searcher->setVerbose(verbose_);
       return info.This();
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
@@ -492,14 +1853,155 @@ class Searcher : public Napi::ObjectWrap<Searcher> {
                     {
                         InstanceMethod<&Searcher::addArchive>("addArchive"),
                         InstanceMethod<&Searcher::search>("search"),
+                        InstanceMethod<&Searcher::searchAsync>("searchAsync"),
+                        InstanceMethod<&Searcher::searchMany>("searchMany"),
+                        InstanceMethod<&Searcher::searchFederated>(
+                            "searchFederated"),
+                        InstanceMethod<&Searcher::countEstimated>(
+                            "countEstimated"),
                         InstanceMethod<&Searcher::setVerbose>("setVerbose"),
+                        InstanceMethod<&Searcher::setResultCache>(
+                            "setResultCache"),
+                        InstanceMethod<&Searcher::getResultCacheStats>(
+                            "getResultCacheStats"),
+                        InstanceMethod<&Searcher::clearResultCache>(
+                            "clearResultCache"),
                     });
 
     exports.Set("Searcher", func);
     constructors.searcher = Napi::Persistent(func);
   }
 
+  // accepts a query string or a Query object
+  static zim::Query queryFrom(Napi::Env env, const Napi::Value &value) {
+    if (value.IsString()) {
+      return zim::Query(value.ToString().Utf8Value());
+    } else if (value.IsObject()) {
+      return *Napi::ObjectWrap<Query>::Unwrap(value.As<Napi::Object>())
+                  ->query();
+    }
+    throw Napi::Error::New(env, "search argument must be a query or string");
+  }
+
  private:
+  static constexpr size_t kDefaultCacheEntries = 1024;
+  static constexpr size_t kDefaultCacheBytes = 16 * 1024 * 1024;
+
+  // searcher of the work run on the executor
+  std::shared_ptr<SearcherHandle> newAsyncHandle() const {
+    return std::make_shared<SearcherHandle>(SearcherHandle{
+        std::make_shared<std::mutex>(), nullptr, archives_, {}, nullptr});
+  }
+
+  /**
+   * The zim::Searcher over the current archives, rebuilt when an
+   * ArchiveHandle it was built from has been swapped since.
+   */
+  std::shared_ptr<zim::Searcher> searcher() {
+    if (searcher_ != nullptr && !archives_.stale()) {
+      return searcher_;
+    }
+
+    if (searcher_ != nullptr) {
+      std::lock_guard<SearchLock> lock(*mutex_);
+      searcher_.reset();
+    }
+    auto archives = archives_.snapshot();
+    std::shared_ptr<zim::Searcher> searcher;
+    if (archives_.slots().size() == 1) {
+      // opened by Archive.preloadFulltextIndex(), it can only be used by one
+      // handle: the executor ones build their own searcher
+      searcher =
+          IndexPreload::TakeSearcher(archives_.slots()[0]->archive().get());
+    }
+    if (searcher == nullptr) {
+      searcher = std::make_shared<zim::Searcher>(archives);
+    }
+    searcher->setVerbose(verbose_);
+    searcher_ = searcher;
+    mutex_ = std::make_shared<SearchLock>(archives);
+    snapshot_ = std::move(archives);
+    cache_->clear();
+    return searcher_;
+  }
+
+  /**
+   * The {weights} of searchFederated(), one finite non-negative number per
+   * archive, all 1 when not set. A negative or NaN weight would make the
+   * cutoff of FederatedTopK skip archives that could still enter the top k.
+   */
+  static std::vector<double> weightsFrom(Napi::Env env,
+                                         const Napi::Value &options,
+                                         size_t nbArchives) {
+    std::vector<double> weights(nbArchives, 1.0);
+    if (!options.IsObject()) {
+      return weights;
+    }
+    auto value = options.As<Napi::Object>().Get("weights");
+    if (value.IsUndefined()) {
+      return weights;
+    }
+    if (!value.IsArray()) {
+      throw Napi::TypeError::New(env, "weights must be an array of numbers");
+    }
+    auto array = value.As<Napi::Array>();
+    if (array.Length() != nbArchives) {
+      throw Napi::RangeError::New(
+          env, "weights must have one entry per archive of the searcher");
+    }
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      const auto weight = array.Get(i).ToNumber().DoubleValue();
+      if (!std::isfinite(weight) || weight < 0) {
+        throw Napi::RangeError::New(
+            env, "weights must be finite and not negative");
+      }
+      weights[i] = weight;
+    }
+    return weights;
+  }
+
+  /**
+   * Result cache key: the query with whitespace runs collapsed (case is kept,
+   * Xapian boolean operators are case sensitive), the georange and the page.
+   * Changes to the archive set clear the cache instead.
+   */
+  static std::string cacheKey(const zim::Query &query,
+                              const SearchWindow &window) {
+    std::ostringstream out;
+    bool space = false;
+    for (auto c : query.m_query) {
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        space = true;
+        continue;
+      }
+      if (space && out.tellp() > 0) {
+        out << ' ';
+      }
+      space = false;
+      out << c;
+    }
+    out << '\x1f';
+    if (query.m_geoquery) {
+      out << std::setprecision(std::numeric_limits<double>::max_digits10)
+          << query.m_latitude << ',' << query.m_longitude << ','
+          << query.m_distance;
+    }
+    out << '\x1f' << window.start << ':' << window.maxResults << ':'
+        << window.snippets;
+    return out.str();
+  }
+
   std::shared_ptr<zim::Searcher> searcher_;
+  ArchiveSet archives_;
+  std::vector<zim::Archive> snapshot_;  // the archives searcher_ was built on
+  bool verbose_;
+  // main thread handle: searcher_, guarded by the lock of its databases
+  SearchMutex mutex_;
+  std::shared_ptr<SearcherHandle> async_;
+  std::shared_ptr<LruCache<std::shared_ptr<SearchPage>>> cache_;
+  // searchers over archives opened again for searchMany(), created on first
+  // use
+  std::shared_ptr<SearcherPoolState> pool_;
+  // one searcher per archive for searchFederated(), created on first use
+  std::shared_ptr<std::vector<SearcherHandle>> federation_;
 };
-
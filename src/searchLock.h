@@ -0,0 +1,73 @@
+#pragma once
+
+#include <zim/archive.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Lock of the Xapian databases behind a set of archives.
+ *
+ * libzim opens the fulltext database of an archive once, on its FileImpl
+ * (right away with OpenConfig.preloadXapianDb), and every zim::Searcher over
+ * that archive adds the same Xapian backend to its own Xapian::Database.
+ * Xapian objects are not thread safe, their reference counts included, so
+ * whatever creates, reads or drops a searcher, a search or a result set
+ * holds the lock of every archive it was built on. Separately opened
+ * archives (two Archive objects for one file) have databases of their own
+ * and do not wait on each other.
+ *
+ * The mutexes are taken in address order, so locks over overlapping
+ * archive sets do not deadlock.
+ */
+class SearchLock {
+ public:
+  explicit SearchLock(const std::vector<zim::Archive> &archives) {
+    for (const auto &archive : archives) {
+      mutexes_.push_back(mutexOf(archive));
+    }
+    std::sort(mutexes_.begin(), mutexes_.end());
+    mutexes_.erase(std::unique(mutexes_.begin(), mutexes_.end()),
+                   mutexes_.end());
+  }
+
+  void lock() {
+    for (const auto &mutex : mutexes_) {
+      mutex->lock();
+    }
+  }
+
+  void unlock() {
+    for (auto it = mutexes_.rbegin(); it != mutexes_.rend(); it++) {
+      (*it)->unlock();
+    }
+  }
+
+ private:
+  // the mutex of the archive's FileImpl, shared by every copy of it
+  static std::shared_ptr<std::mutex> mutexOf(const zim::Archive &archive) {
+    static std::mutex registryMutex;
+    static std::map<const void *, std::weak_ptr<std::mutex>> registry;
+
+    const void *key = archive.getImpl().get();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto it = registry.begin(); it != registry.end();) {
+      it = it->second.expired() ? registry.erase(it) : std::next(it);
+    }
+    // a FileImpl reusing the address of a dead one while its mutex is still
+    // held only shares the lock, it never misses it
+    auto &slot = registry[key];
+    auto mutex = slot.lock();
+    if (mutex == nullptr) {
+      mutex = std::make_shared<std::mutex>();
+      slot = mutex;
+    }
+    return mutex;
+  }
+
+  std::vector<std::shared_ptr<std::mutex>> mutexes_;
+};
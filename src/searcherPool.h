@@ -0,0 +1,113 @@
+#pragma once
+
+#include <napi.h>
+#include <zim/search.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "archiveHandle.h"
+#include "cancellation.h"
+#include "common.h"
+#include "executor.h"
+#include "search.h"
+
+/**
+ * N Searchers over the same archives, each opening them again (see
+ * SearcherHandle) so that concurrent async searches do not queue behind a
+ * single Xapian database.
+ */
+class SearcherPool : public Napi::ObjectWrap<SearcherPool> {
+ public:
+  static constexpr size_t kMaxSize = 64;
+
+  explicit SearcherPool(const Napi::CallbackInfo &info)
+      : Napi::ObjectWrap<SearcherPool>(info), state_{nullptr} {
+    Napi::Env env = info.Env();
+
+    // SearcherPool(archives: Archive | Archive[], [options: {size}])
+    auto archives =
+        ArchiveHandle::archiveSetFrom(env, info[0], "SearcherPool");
+    size_t size = std::max(2u, std::thread::hardware_concurrency());
+    if (info[1].IsObject() && info[1].As<Napi::Object>().Has("size")) {
+      auto value = info[1].As<Napi::Object>().Get("size");
+      if (!value.IsNumber()) {
+        throw Napi::TypeError::New(env, "size must be a number");
+      }
+      const auto requested = value.ToNumber().Int64Value();
+      if (requested < 1 || requested > static_cast<int64_t>(kMaxSize)) {
+        throw Napi::RangeError::New(env,
+                                    "size must be between 1 and " +
+                                        std::to_string(kMaxSize));
+      }
+      size = static_cast<size_t>(requested);
+    }
+
+    state_ = std::make_shared<SearcherPoolState>(archives, size);
+  }
+
+  /**
+   * searchAsync(query, [{start, maxResults, snippets, priority, signal,
+   * timeoutMs}]) runs the query on the first free searcher of the pool,
+   * resolving with a SearchResultSet. Snippets are generated there too
+   * unless snippets is false.
+   */
+  Napi::Value searchAsync(const Napi::CallbackInfo &info) {
+    // outside of the try, so a RangeError keeps its type
+    const auto window = SearchWindow::From(info.Env(), info[1]);
+    try {
+      auto env = info.Env();
+      auto query = Searcher::queryFrom(env, info[0]);
+      const auto priority = Executor::priorityFrom(
+          env, info[1], Executor::Priority::Interactive);
+
+      auto state = state_;
+      const auto queuedAt = SearcherPoolState::Clock::now();
+      state->submitted();
+      return ExecutorPromiseWorker<SearcherPoolState::Page>::Run(
+          env, priority,
+          [state, query, window, queuedAt]() {
+            return state->search(queuedAt, query, window);
+          },
+          [](Napi::Env env, SearcherPoolState::Page &page) {
+            return SearchResultSet::New(env, page);
+          },
+          Cancellation::From(env, info[1]), state->submitter());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  Napi::Value getSize(const Napi::CallbackInfo &info) {
+    return Napi::Value::From(info.Env(), state_->size());
+  }
+
+  Napi::Value getStats(const Napi::CallbackInfo &info) {
+    try {
+      return state_->stats(info.Env());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  static void Init(Napi::Env env, Napi::Object exports,
+                   ModuleConstructors &constructors) {
+    Napi::Function func = DefineClass(
+        env, "SearcherPool",
+        {
+            InstanceMethod<&SearcherPool::searchAsync>("searchAsync"),
+            InstanceMethod<&SearcherPool::getStats>("getStats"),
+            InstanceAccessor<&SearcherPool::getSize>("size"),
+        });
+
+    exports.Set("SearcherPool", func);
+    constructors.searcherPool = Napi::Persistent(func);
+  }
+
+ private:
+  std::shared_ptr<SearcherPoolState> state_;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * Search snippet split into plain text and highlight ranges.
+ *
+ * libzim returns Xapian's HTML snippet: escaped text with matches wrapped in
+ * <b></b>. The markup is parsed once here so callers can apply their own
+ * escaping. Offsets are [start, end) pairs in UTF-16 code units, so they
+ * index the JS string directly.
+ */
+struct StructuredSnippet {
+  std::u16string text;
+  std::vector<uint32_t> highlights;
+
+  static StructuredSnippet Parse(const std::string &html) {
+    StructuredSnippet res;
+    res.text.reserve(html.size());
+    bool open = false;
+    size_t i = 0;
+    while (i < html.size()) {
+      const char c = html[i];
+      if (c == '<') {
+        const auto end = html.find('>', i);
+        if (end == std::string::npos) {
+          res.appendUtf8(html, i, html.size());
+          break;
+        }
+        const auto tag = html.substr(i + 1, end - i - 1);
+        if (tag == "b" && !open) {
+          res.highlights.push_back(res.text.size());
+          open = true;
+        } else if (tag == "/b" && open) {
+          res.highlights.push_back(res.text.size());
+          open = false;
+        }
+        i = end + 1;
+      } else if (c == '&') {
+        i = res.appendEntity(html, i);
+      } else {
+        const auto next = html.find_first_of("<&", i);
+        const auto end = next == std::string::npos ? html.size() : next;
+        res.appendUtf8(html, i, end);
+        i = end;
+      }
+    }
+    if (open) {
+      res.highlights.push_back(res.text.size());
+    }
+    return res;
+  }
+
+  Napi::Object ToObject(Napi::Env env) const {
+    auto obj = Napi::Object::New(env);
+    auto ranges = Napi::Uint32Array::New(env, highlights.size());
+    for (size_t i = 0; i < highlights.size(); i++) {
+      ranges[i] = highlights[i];
+    }
+    obj["text"] = Napi::String::New(env, text);
+    obj["highlights"] = ranges;
+    return obj;
+  }
+
+ private:
+  void appendCodePoint(uint32_t cp) {
+    if (cp >= 0x10000) {
+      cp -= 0x10000;
+      text.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+      text.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+    } else {
+      text.push_back(static_cast<char16_t>(cp));
+    }
+  }
+
+  // decodes html[begin, end), invalid bytes become U+FFFD
+  void appendUtf8(const std::string &html, size_t begin, size_t end) {
+    size_t i = begin;
+    while (i < end) {
+      const auto byte = static_cast<uint8_t>(html[i]);
+      size_t len = 0;
+      uint32_t cp = 0;
+      if (byte < 0x80) {
+        len = 1;
+        cp = byte;
+      } else if ((byte & 0xE0) == 0xC0) {
+        len = 2;
+        cp = byte & 0x1F;
+      } else if ((byte & 0xF0) == 0xE0) {
+        len = 3;
+        cp = byte & 0x0F;
+      } else if ((byte & 0xF8) == 0xF0) {
+        len = 4;
+        cp = byte & 0x07;
+      }
+
+      bool valid = len > 0 && i + len <= end;
+      for (size_t j = 1; valid && j < len; j++) {
+        const auto cont = static_cast<uint8_t>(html[i + j]);
+        valid = (cont & 0xC0) == 0x80;
+        cp = (cp << 6) | (cont & 0x3F);
+      }
+      if (!valid || cp > 0x10FFFF) {
+        appendCodePoint(0xFFFD);
+        i++;
+        continue;
+      }
+      appendCodePoint(cp);
+      i += len;
+    }
+  }
+
+  // decodes the entity at html[pos], returns the position after it
+  size_t appendEntity(const std::string &html, size_t pos) {
+    static constexpr size_t kMaxEntity = 10;
+    const auto end = html.find(';', pos);
+    if (end == std::string::npos || end - pos > kMaxEntity) {
+      text.push_back(u'&');
+      return pos + 1;
+    }
+
+    const auto name = html.substr(pos + 1, end - pos - 1);
+    if (name == "amp") {
+      text.push_back(u'&');
+    } else if (name == "lt") {
+      text.push_back(u'<');
+    } else if (name == "gt") {
+      text.push_back(u'>');
+    } else if (name == "quot") {
+      text.push_back(u'"');
+    } else if (name == "apos") {
+      text.push_back(u'\'');
+    } else if (name.size() > 1 && name[0] == '#') {
+      const bool hex = name[1] == 'x' || name[1] == 'X';
+      const auto digits = name.substr(hex ? 2 : 1);
+      char *last = nullptr;
+      const auto cp = std::strtoul(digits.c_str(), &last, hex ? 16 : 10);
+      if (digits.empty() || *last != '\0' || cp > 0x10FFFF) {
+        text.push_back(u'&');
+        return pos + 1;
+      }
+      appendCodePoint(cp);
+    } else {
+      text.push_back(u'&');
+      return pos + 1;
+    }
+    return end + 1;
+  }
+};
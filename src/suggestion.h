@@ -3,15 +3,96 @@
 #include <napi.h>
 #include <zim/suggestion.h>
 
+#include <cctype>
 #include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "archive.h"
+#include "archiveHandle.h"
+#include "cancellation.h"
 #include "common.h"
 #include "entry.h"
+#include "executor.h"
+#include "lruCache.h"
+
+/**
+ * One suggestion copied out of a zim::SuggestionResultSet, so results can be
+ * built on an executor thread and cached.
+ */
+struct SuggestionHit {
+  std::string title;
+  std::string path;
+  std::string snippet;
+  bool hasSnippet;
+
+  static std::vector<SuggestionHit> Collect(
+      const zim::SuggestionResultSet &results, bool snippets) {
+    std::vector<SuggestionHit> hits;
+    for (auto it = results.begin(); it != results.end(); it++) {
+      auto &item = *it;
+      const bool hasSnippet = snippets && item.hasSnippet();
+      hits.push_back(SuggestionHit{item.getTitle(), item.getPath(),
+                                   hasSnippet ? item.getSnippet() : "",
+                                   hasSnippet});
+    }
+    return hits;
+  }
+
+  // estimated memory use, for the cache limits
+  static size_t Bytes(const std::vector<SuggestionHit> &hits) {
+    size_t bytes = 0;
+    for (const auto &hit : hits) {
+      bytes += sizeof(hit) + hit.title.size() + hit.path.size() +
+               hit.snippet.size();
+    }
+    return bytes;
+  }
+
+  // [{title, path, snippet?}]
+  static Napi::Array ToArray(Napi::Env env,
+                             const std::vector<SuggestionHit> &hits) {
+    auto res = Napi::Array::New(env, hits.size());
+    for (size_t i = 0; i < hits.size(); i++) {
+      auto obj = Napi::Object::New(env);
+      obj["title"] = hits[i].title;
+      obj["path"] = hits[i].path;
+      if (hits[i].hasSnippet) obj["snippet"] = hits[i].snippet;
+      res.Set(i, obj);
+    }
+    return res;
+  }
+
+  // {titles, paths, snippets?}, snippets are null where the hit has none
+  static Napi::Object ToColumns(Napi::Env env,
+                                const std::vector<SuggestionHit> &hits,
+                                bool snippets) {
+    auto titles = Napi::Array::New(env, hits.size());
+    auto paths = Napi::Array::New(env, hits.size());
+    auto res = Napi::Object::New(env);
+    for (size_t i = 0; i < hits.size(); i++) {
+      titles.Set(i, Napi::String::New(env, hits[i].title));
+      paths.Set(i, Napi::String::New(env, hits[i].path));
+    }
+    res["titles"] = titles;
+    res["paths"] = paths;
+    if (snippets) {
+      auto column = Napi::Array::New(env, hits.size());
+      for (size_t i = 0; i < hits.size(); i++) {
+        column.Set(i, hits[i].hasSnippet
+                          ? Napi::String::New(env, hits[i].snippet)
+                          : env.Null());
+      }
+      res["snippets"] = column;
+    }
+    return res;
+  }
+};
 
 class SuggestionIterator : public Napi::ObjectWrap<SuggestionIterator> {
  public:
@@ -79,6 +160,8 @@ class SuggestionIterator : public Napi::ObjectWrap<SuggestionIterator> {
             InstanceAccessor<&SuggestionIterator::getTitle>("title"),
             InstanceAccessor<&SuggestionIterator::getPath>("path"),
             InstanceAccessor<&SuggestionIterator::getSnippet>("snippet"),
+            InstanceAccessor<&SuggestionIterator::hasSnippet>("hasSnippet"),
+            // misspelled name kept for existing callers
             InstanceAccessor<&SuggestionIterator::hasSnippet>("haSnippet"),
         });
 
@@ -215,6 +298,41 @@ class SuggestionSearch : public Napi::ObjectWrap<SuggestionSearch> {
     }
   }
 
+  /**
+   * getResultsArray(start, maxResults, [{snippets, columnar}]) copies a page
+   * of suggestions in one pass: [{title, path, snippet?}], or with columnar
+   * {titles, paths, snippets?}.
+   */
+  Napi::Value getResultsArray(const Napi::CallbackInfo &info) {
+    try {
+      auto env = info.Env();
+      if (!(info[0].IsNumber() && info[1].IsNumber())) {
+        throw Napi::Error::New(env,
+                               "getResultsArray must be called with start "
+                               "and maxResults values of type Number");
+      }
+
+      bool snippets = false;
+      bool columnar = false;
+      if (info[2].IsObject()) {
+        auto options = info[2].As<Napi::Object>();
+        snippets = options.Get("snippets").ToBoolean();
+        columnar = options.Get("columnar").ToBoolean();
+      }
+
+      auto start = info[0].ToNumber();
+      auto maxResults = info[1].ToNumber();
+      const auto hits = SuggestionHit::Collect(
+          search_->getResults(start, maxResults), snippets);
+      if (columnar) {
+        return SuggestionHit::ToColumns(env, hits, snippets);
+      }
+      return SuggestionHit::ToArray(env, hits);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
   Napi::Value getEstimatedMatches(const Napi::CallbackInfo &info) {
     try {
       return Napi::Value::From(info.Env(), search_->getEstimatedMatches());
@@ -229,6 +347,8 @@ class SuggestionSearch : public Napi::ObjectWrap<SuggestionSearch> {
         env, "SuggestionSearch",
         {
             InstanceMethod<&SuggestionSearch::getResults>("getResults"),
+            InstanceMethod<&SuggestionSearch::getResultsArray>(
+                "getResultsArray"),
             InstanceAccessor<&SuggestionSearch::getEstimatedMatches>(
                 "estimatedMatches"),
         });
@@ -245,7 +365,12 @@ class SuggestionSearcher : public Napi::ObjectWrap<SuggestionSearcher> {
  public:
   explicit SuggestionSearcher(const Napi::CallbackInfo &info)
       : Napi::ObjectWrap<SuggestionSearcher>(info),
-        suggestionSearcher_{nullptr} {
+        suggestionSearcher_{nullptr},
+        archives_{},
+        verbose_{false},
+        async_{nullptr},
+        cache_{std::make_shared<LruCache<std::vector<SuggestionHit>>>(
+            kDefaultCacheEntries, kDefaultCacheBytes)} {
     Napi::Env env = info.Env();
 
     // TODO(kelvinhammond): Ask about support for suggestions from multiple
@@ -276,10 +401,12 @@ class SuggestionSearcher : public Napi::ObjectWrap<SuggestionSearcher> {
       suggestionSearcher_ = std::make_shared<zim::SuggestionSearcher>(archives);
     } else */
     if (info[0].IsObject()) {  // one archive
-      auto archive =
-          Napi::ObjectWrap<Archive>::Unwrap(info[0].As<Napi::Object>())
-              ->archive();
-      suggestionSearcher_ = std::make_shared<zim::SuggestionSearcher>(*archive);
+      archives_.add(ArchiveHandle::slotFrom(env, info[0].As<Napi::Object>()));
+      try {
+        suggestionSearcher();
+      } catch (const std::exception &err) {
+        throw Napi::Error::New(env, err.what());
+      }
     } else {
       throw Napi::Error::New(
           env,
@@ -311,7 +438,7 @@ class SuggestionSearcher : public Napi::ObjectWrap<SuggestionSearcher> {
     try {
       auto env = info.Env();
       if (info[0].IsString()) {
-        auto &&search = suggestionSearcher_->suggest(info[0].ToString());
+        auto &&search = suggestionSearcher()->suggest(info[0].ToString());
         return SuggestionSearch::New(env, std::move(search));
       }
       throw Napi::Error::New(env, "suggest argument must be a string");
@@ -320,9 +447,115 @@ class SuggestionSearcher : public Napi::ObjectWrap<SuggestionSearcher> {
     }
   }
 
+  /**
+   * suggestAsync(text, [{start, max, snippets, priority, signal, timeoutMs}])
+   * resolves with plain {title, path, snippet?} objects. It runs on the
+   * executor against a database handle of its own, and answers repeated
+   * prefixes from an LRU cache keyed by archive and normalized text.
+   */
+  Napi::Value suggestAsync(const Napi::CallbackInfo &info) {
+    try {
+      auto env = info.Env();
+      if (!info[0].IsString()) {
+        throw Napi::Error::New(env, "suggestAsync argument must be a string");
+      }
+
+      const std::string text = info[0].ToString();
+      int start = 0;
+      int max = kDefaultMax;
+      bool snippets = false;
+      if (info[1].IsObject()) {
+        auto options = info[1].As<Napi::Object>();
+        if (options.Has("start")) {
+          start = options.Get("start").ToNumber().Int32Value();
+        }
+        if (options.Has("max")) {
+          max = options.Get("max").ToNumber().Int32Value();
+        }
+        snippets = options.Get("snippets").ToBoolean();
+      }
+      if (start < 0 || max < 0) {
+        throw Napi::RangeError::New(env, "start and max must not be negative");
+      }
+      const auto priority = Executor::priorityFrom(
+          env, info[1], Executor::Priority::Interactive);
+      auto cancellation = Cancellation::From(env, info[1]);
+
+      auto worker = asyncWorker();
+      auto cache = cache_;
+      std::string key;
+      if (cache->enabled()) {
+        std::ostringstream out;
+        out << worker->zimId << '\x1f' << normalize(text, worker->foldCase)
+            << '\x1f' << start << ':' << max << ':' << snippets;
+        key = out.str();
+        if (auto cached = cache->get(key)) {
+          auto deferred = Napi::Promise::Deferred::New(env);
+          if (!cancellation ||
+              !cancellation->rejectIfExpired(env, deferred)) {
+            deferred.Resolve(SuggestionHit::ToArray(env, *cached));
+          }
+          return deferred.Promise();
+        }
+      }
+
+      return ExecutorPromiseWorker<std::vector<SuggestionHit>>::Run(
+          env, priority,
+          [worker, text, start, max, snippets]() {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            auto results =
+                worker->searcher.suggest(text).getResults(start, max);
+            return SuggestionHit::Collect(results, snippets);
+          },
+          [cache, key](Napi::Env env, std::vector<SuggestionHit> &hits) {
+            if (!key.empty()) {
+              cache->put(key, hits, SuggestionHit::Bytes(hits));
+            }
+            return SuggestionHit::ToArray(env, hits);
+          },
+          cancellation);
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  /**
+   * setResultCache({maxEntries, maxBytes}) resizes the suggestAsync() cache,
+   * setResultCache(false) disables it. It is on by default.
+   */
+  Napi::Value setResultCache(const Napi::CallbackInfo &info) {
+    // outside of the try, so a RangeError keeps its type
+    const auto [maxEntries, maxBytes] = cacheLimitsFrom(
+        info.Env(), info[0], kDefaultCacheEntries, kDefaultCacheBytes);
+    try {
+      cache_->setLimits(maxEntries, maxBytes);
+      return info.This();
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  Napi::Value getResultCacheStats(const Napi::CallbackInfo &info) {
+    try {
+      return cache_->stats(info.Env());
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
+  Napi::Value clearResultCache(const Napi::CallbackInfo &info) {
+    try {
+      cache_->clear();
+      return info.This();
+    } catch (const std::exception &err) {
+      throw Napi::Error::New(info.Env(), err.what());
+    }
+  }
+
   Napi::Value setVerbose(const Napi::CallbackInfo &info) {
     try {
-      suggestionSearcher_->setVerbose(info[0].ToBoolean());
+      verbose_ = info[0].ToBoolean();
+      suggestionSearcher()->setVerbose(verbose_);
       return info.This();
     } catch (const std::exception &err) {
       throw Napi::Error::New(info.Env(), err.what());
@@ -336,6 +569,13 @@ class SuggestionSearcher : public Napi::ObjectWrap<SuggestionSearcher> {
         {
             // InstanceMethod<&SuggestionSearcher::addArchive>("addArchive"),
             InstanceMethod<&SuggestionSearcher::suggest>("suggest"),
+            InstanceMethod<&SuggestionSearcher::suggestAsync>("suggestAsync"),
+            InstanceMethod<&SuggestionSearcher::setResultCache>(
+                "setResultCache"),
+            InstanceMethod<&SuggestionSearcher::getResultCacheStats>(
+                "getResultCacheStats"),
+            InstanceMethod<&SuggestionSearcher::clearResultCache>(
+                "clearResultCache"),
             InstanceMethod<&SuggestionSearcher::setVerbose>("setVerbose"),
         });
 
@@ -344,6 +584,89 @@ class SuggestionSearcher : public Napi::ObjectWrap<SuggestionSearcher> {
   }
 
  private:
+  static constexpr int kDefaultMax = 10;
+  static constexpr size_t kDefaultCacheEntries = 4096;
+  static constexpr size_t kDefaultCacheBytes = 4 << 20;
+
+  /**
+   * Searcher of suggestAsync(), separate from the one of suggest() since
+   * Xapian handles are not thread safe: its mutex only serializes executor
+   * threads.
+   */
+  struct AsyncWorker {
+    explicit AsyncWorker(const zim::Archive &archive)
+        : searcher{archive}, foldCase{archive.hasTitleIndex()} {
+      std::ostringstream out;
+      out << archive.getUuid();
+      zimId = out.str();
+    }
+
+    std::mutex mutex;
+    zim::SuggestionSearcher searcher;
+    std::string zimId;
+    // the title index matches case insensitively, the title order does not
+    bool foldCase;
+  };
+
+  // rebuilt when the ArchiveHandle it was built from has been swapped since
+  std::shared_ptr<zim::SuggestionSearcher> suggestionSearcher() {
+    if (suggestionSearcher_ != nullptr && !archives_.stale()) {
+      return suggestionSearcher_;
+    }
+
+    archive_ = std::make_shared<zim::Archive>(archives_.snapshot()[0]);
+    // opened by Archive.preloadTitleIndex()
+    auto searcher = IndexPreload::TakeSuggestionSearcher(
+        archives_.slots()[0]->archive().get());
+    if (searcher == nullptr) {
+      searcher = std::make_shared<zim::SuggestionSearcher>(*archive_);
+    }
+    searcher->setVerbose(verbose_);
+    suggestionSearcher_ = searcher;
+    async_ = nullptr;
+    return suggestionSearcher_;
+  }
+
+  std::shared_ptr<AsyncWorker> asyncWorker() {
+    suggestionSearcher();
+    if (async_ == nullptr) {
+      async_ = std::make_shared<AsyncWorker>(*archive_);
+      async_->searcher.setVerbose(verbose_);
+    }
+    return async_;
+  }
+
+  /**
+   * Cache key text: leading whitespace dropped and runs collapsed, ASCII
+   * lowercased when the archive has a title index.
+   */
+  static std::string normalize(const std::string &text, bool foldCase) {
+    std::string res;
+    bool space = false;
+    for (auto c : text) {
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        space = true;
+        continue;
+      }
+      if (space && !res.empty()) {
+        res += ' ';
+      }
+      space = false;
+      res += foldCase ? static_cast<char>(
+                            std::tolower(static_cast<unsigned char>(c)))
+                      : c;
+    }
+    if (space && !res.empty()) {
+      res += ' ';  // a trailing space ends the last word, keep it
+    }
+    return res;
+  }
+
   std::shared_ptr<zim::SuggestionSearcher> suggestionSearcher_;
+  ArchiveSet archives_;
+  bool verbose_;
+  std::shared_ptr<zim::Archive> archive_;
+  std::shared_ptr<AsyncWorker> async_;
+  std::shared_ptr<LruCache<std::vector<SuggestionHit>>> cache_;
 };
 
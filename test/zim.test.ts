@@ -12,21 +12,28 @@ import {
 } from "node:test";
 import {
   Archive,
+  ArchiveHandle,
+  AutocompleteIndex,
   Blob,
   Compression,
   Creator,
+  FuzzyTitleIndex,
   IllustrationInfo,
   IntegrityCheck,
   OpenConfig,
   Query,
   Searcher,
+  SearcherPool,
   StringItem,
   StringProvider,
   SuggestionSearcher,
   type WriterItem,
   getClusterCacheCurrentSize,
   getClusterCacheMaxSize,
+  getDirectReadStats,
+  getExecutorStats,
   setClusterCacheMaxSize,
+  setThreadPoolSize,
 } from "../src/index.js";
 
 describe("IntegrityCheck", () => {
@@ -423,6 +430,52 @@ describe("Archive", () => {
     assert.equal(Archive.validate(outFile, checks), true);
   });
 
+  it("Validates an archive asynchronously", async () => {
+    const checks = [IntegrityCheck.CHECKSUM];
+    assert.equal(await Archive.validateAsync(outFile, checks), true);
+
+    const archive = new Archive(outFile);
+    const [checked, integrity] = await Promise.all([
+      archive.checkAsync({ priority: "background" }),
+      archive.checkIntegrityAsync(IntegrityCheck.CHECKSUM),
+    ]);
+    assert.equal(checked, true);
+    assert.equal(integrity, true);
+    assert.throws(() => archive.checkAsync({ priority: "urgent" } as never));
+
+    const stats = getExecutorStats();
+    assert.equal(stats.background.queued, 0);
+    assert.equal(typeof stats.interactive.queued, "number");
+    assert.equal(
+      stats.threads === 1 || stats.backgroundLimit < stats.threads,
+      true,
+    );
+  });
+
+  it("Resizes the native thread pool", async () => {
+    const archive = new Archive(outFile);
+    // the pool starts on the first submit, 0 until then
+    await archive.checkAsync();
+    const { threads } = getExecutorStats();
+    try {
+      setThreadPoolSize(3);
+      assert.equal(getExecutorStats().threads, 3);
+      const results = await Promise.all(
+        Array.from(Array(10).keys()).map(() => archive.checkAsync()),
+      );
+      assert.deepEqual(new Set(results), new Set([true]));
+      assert.equal(getExecutorStats().workers.length >= 3, true);
+      assert.throws(() => setThreadPoolSize(0), RangeError);
+
+      // a lone thread still runs background work
+      setThreadPoolSize(1);
+      assert.equal(getExecutorStats().backgroundLimit, 1);
+      assert.equal(await archive.checkAsync({ priority: "background" }), true);
+    } finally {
+      setThreadPoolSize(threads);
+    }
+  });
+
   it("Opens an archive with OpenConfig", () => {
     const config = new OpenConfig()
       .preloadXapianDb(true)
@@ -433,6 +486,53 @@ describe("Archive", () => {
     assert.equal(archive.allEntryCount >= items.length, true);
   });
 
+  it("Preloads the Xapian indexes", async () => {
+    const archive = new Archive(outFile);
+    const phases: string[] = [];
+    const preloaded = archive.preloadFulltextIndex({
+      onProgress: ({ phase, bytesRead, totalBytes }) => {
+        assert(bytesRead <= totalBytes);
+        phases.push(phase);
+      },
+    });
+    assert.equal(preloaded.found, true);
+    assert.equal(preloaded.opened, true);
+    assert(preloaded.bytesRead > 0);
+    assert.equal(preloaded.bytesRead, preloaded.totalBytes);
+    assert.deepEqual(phases.slice(-2), ["read", "open"]);
+    // the next searcher adopts the opened database
+    const searcher = new Searcher(archive);
+    assert.equal(searcher.search(testText).estimatedMatches, items.length);
+
+    const titlePreload = await archive.preloadTitleIndex({ async: true });
+    assert.equal(titlePreload.found, true);
+    assert.equal(titlePreload.opened, true);
+    assert(titlePreload.bytesRead > 0);
+    assert.equal(typeof titlePreload.elapsedMs, "number");
+  });
+
+  it("Scans entries on native threads", async () => {
+    const archive = new Archive(outFile);
+    const all = await archive.scan();
+    assert(all instanceof Uint32Array);
+    assert.equal(all.length, entries.length);
+
+    const binaries = await archive.scan(
+      { mimetypes: ["application/octet-stream"], minSize: 10 },
+      { threads: 3 },
+    );
+    assert.deepEqual(
+      Array.from(binaries, (i) => archive.getEntryByPath(i).path).sort(),
+      blobs.map(({ path }) => path),
+    );
+    const paths = await archive.scan({ pathRegex: "^test[0-2]$" });
+    assert.equal(paths.length, 3);
+    assert.equal((await archive.scan({ maxSize: 0 })).length, 0);
+    await assert.rejects(archive.scan({}, { timeoutMs: 0 }), {
+      name: "TimeoutError",
+    });
+  });
+
   it("Reads items from an archive", () => {
     const archive = new Archive(outFile);
     assert(archive);
@@ -556,6 +656,38 @@ describe("Archive", () => {
       items[3].path,
     );
 
+    const listing = archive.listByPathPrefix("test", { start: 2, limit: 3 });
+    assert.equal(listing.count, items.length);
+    assert.deepEqual(
+      listing.entries.map(({ path }) => path),
+      ["test2", "test3", "test4"],
+    );
+    assert.deepEqual(
+      archive.listByPathPrefix("test3", { fields: ["path", "mimetype"] })
+        .entries,
+      [{ path: "test3", mimetype: "text/html" }],
+    );
+    const byTitle = archive.listByTitlePrefix(testText, { start: 9 });
+    assert.equal(byTitle.count, items.length);
+    assert.equal(byTitle.entries.length, 1);
+    assert.equal(archive.listByTitlePrefix("xyz").count, 0);
+
+    const sample = archive.sampleEntries(3, { seed: 42 });
+    assert.equal(sample.length, 3);
+    assert.equal(new Set(sample.map(({ path }) => path)).size, 3);
+    assert.deepEqual(archive.sampleEntries(3, { seed: 42 }), sample);
+    assert.equal(archive.sampleEntries(100).length, items.length);
+    const binaries = archive.sampleEntries(100, {
+      frontArticlesOnly: false,
+      mimetypes: ["application/octet-stream"],
+      minSize: 10,
+      fields: ["path", "size"],
+    });
+    assert.deepEqual(
+      binaries.map(({ path }) => path).sort(),
+      blobs.map(({ path }) => path),
+    );
+
     assert.equal(archive.hasChecksum, true);
     assert(archive.checksum);
 
@@ -611,6 +743,117 @@ describe("Archive", () => {
     }
   });
 
+  it("reads item data directly", async () => {
+    const archive = new Archive(outFile);
+
+    for (const entry of [...items, ...blobs, ...null_blobs]) {
+      const item = archive.getEntryByPath(entry.path).item;
+      const expected = item.data.data;
+      assert.deepEqual(await item.readDirect(), expected);
+      assert.deepEqual((await item.getDataAsync()).data, expected);
+      assert.deepEqual(await item.readDirect(1, 3), expected.subarray(1, 4));
+    }
+
+    const stats = getDirectReadStats();
+    assert.equal(stats.backend, "pread");
+    assert.equal(stats.queueDepth, 0);
+    assert.equal(stats.completed > 0, true);
+    assert.equal(typeof stats.avgLatencyMs, "number");
+  });
+
+  it("Opens an archive from a file descriptor", () => {
+    const archive = new Archive(outFile);
+    const fd = fs.openSync(outFile, "r");
+    try {
+      assert.equal(Archive.fromFd(fd).uuid, archive.uuid);
+    } finally {
+      fs.closeSync(fd);
+    }
+
+    // zim embedded in a larger bundle file
+    const bundle = "./test-bundle.bin";
+    const data = fs.readFileSync(outFile);
+    fs.writeFileSync(bundle, Buffer.concat([Buffer.alloc(512, 1), data]));
+    const bundleFd = fs.openSync(bundle, "r");
+    try {
+      const embedded = Archive.fromFd(bundleFd, {
+        offset: 512,
+        size: data.length,
+      });
+      fs.closeSync(bundleFd);
+      assert.equal(embedded.uuid, archive.uuid);
+      assert.equal(
+        embedded.getEntryByPath("test0").item.data.data.toString(),
+        "Hello world 0!",
+      );
+    } finally {
+      fs.rmSync(bundle);
+    }
+  });
+
+  it("hot-swaps an archive handle", async () => {
+    const other = "./test-swap.zim";
+    const creator = new Creator()
+      .configIndexing(true, "en")
+      .startZimCreation(other);
+    for (const i of [0, 1]) {
+      await creator.addItem(
+        new StringItem(
+          `swapped${i}`,
+          "text/html",
+          `swapped page ${i}`,
+          { FRONT_ARTICLE: 1 },
+          `Goodbye world ${i}!`,
+        ),
+      );
+    }
+    await creator.finishZimCreation();
+
+    try {
+      const handle = new ArchiveHandle(outFile);
+      assert.equal(handle.generation, 0);
+      const before = handle.archive;
+      const searcher = new Searcher(handle);
+      const suggestionSearcher = new SuggestionSearcher(handle);
+      assert.equal(searcher.search(testText).estimatedMatches, items.length);
+      assert.equal(
+        suggestionSearcher.suggest(testText).estimatedMatches,
+        items.length,
+      );
+
+      const swapped = await handle.swap(other);
+      assert.equal(handle.generation, 1);
+      assert.notEqual(swapped.uuid, before.uuid);
+      assert.equal(handle.archive.uuid, swapped.uuid);
+      assert.equal(handle.archive.getEntryByPath("swapped0").path, "swapped0");
+
+      // searchers built on the handle follow it to the new file
+      assert.equal(searcher.search(testText).estimatedMatches, 0);
+      assert.deepEqual(
+        Array.from(searcher.search("swapped").getResults(0, 10))
+          .map((res) => res.path)
+          .sort(),
+        ["swapped0", "swapped1"],
+      );
+      assert.equal(suggestionSearcher.suggest(testText).estimatedMatches, 0);
+      assert.equal(suggestionSearcher.suggest("swapped").estimatedMatches, 2);
+
+      // the previous archive stays usable by whoever still holds it
+      assert.equal(before.getEntryByPath("test0").title, `${testText} 0`);
+      assert.equal(before.hasEntryByPath("swapped0"), false);
+      assert.equal(
+        new Searcher(before).search(testText).estimatedMatches,
+        items.length,
+      );
+
+      await assert.rejects(handle.swap("./missing.zim"));
+      assert.equal(handle.generation, 1);
+      assert.equal(handle.archive.uuid, swapped.uuid);
+    } finally {
+      fs.rmSync(other, { force: true });
+    }
+  });
+
   describe("Searcher", () => {
     it("searches the archive", () => {
       const archive = new Archive(outFile);
@@ -637,6 +880,402 @@ describe("Archive", () => {
         assert.match(item.title, new RegExp(`^${testText} \\d+\$`));
       }
     });
+
+    it("returns suggestions as plain arrays", () => {
+      const suggestion = new SuggestionSearcher(
+        new Archive(outFile),
+      ).suggest(testText);
+      const expected = Array.from(suggestion.getResults(0, 3)).map(
+        ({ title, path }) => ({ title, path }),
+      );
+      assert.deepEqual(suggestion.getResultsArray(0, 3), expected);
+
+      const columns = suggestion.getResultsArray(0, 3, { columnar: true });
+      assert.deepEqual(columns, {
+        titles: expected.map(({ title }) => title),
+        paths: expected.map(({ path }) => path),
+      });
+
+      const withSnippets = suggestion.getResultsArray(0, 3, {
+        snippets: true,
+        columnar: true,
+      });
+      assert.equal(withSnippets.snippets?.length, 3);
+      const [first] = suggestion.getResults(0, 1);
+      assert.equal(first.hasSnippet, first.haSnippet);
+    });
+
+    it("materializes search results", () => {
+      const searcher = new Searcher(new Archive(outFile));
+      const results = searcher.search(testText).getResults(0, 100);
+
+      const all = results.toArray();
+      assert.equal(all.length, items.length);
+      assert.deepEqual(
+        all.map((res) => res.path),
+        Array.from(results).map((res) => res.path),
+      );
+      assert.equal(all[0].snippet, undefined);
+      assert.equal(typeof all[0].zimId, "string");
+
+      const slim = results.toArray({ fields: ["path", "score"] });
+      assert.deepEqual(Object.keys(slim[0]).sort(), ["path", "score"]);
+      const withSnippets = results.toArray({
+        fields: ["path"],
+        snippets: true,
+      });
+      assert.equal(typeof withSnippets[0].snippet, "string");
+      const structured = results.toArray({
+        fields: ["path"],
+        snippets: "structured",
+      });
+      for (const { snippet } of structured) {
+        assert(snippet && typeof snippet === "object");
+        assert.equal(snippet.text.includes("<b>"), false);
+        assert.equal(snippet.highlights.length % 2, 0);
+        for (const offset of snippet.highlights) {
+          assert(offset <= snippet.text.length);
+        }
+      }
+      const first = Array.from(results)[0];
+      assert.equal(
+        first.structuredSnippet.text,
+        first.snippet.replace(/<\/?b>/g, ""),
+      );
+      assert.throws(() => results.toArray({ fields: ["nope" as never] }));
+
+      const archive = new Archive(outFile);
+      const enriched = new Searcher(archive)
+        .search(testText)
+        .getResults(0, 100, { include: ["mimetype", "size", "isRedirect"] })
+        .toArray({ include: ["redirectPath"] });
+      for (const res of enriched) {
+        const entry = archive.getEntryByPath(res.path!);
+        assert.equal(res.mimetype, entry.item.mimetype);
+        assert.equal(res.size, Number(entry.item.size));
+        assert.equal(res.isRedirect, false);
+        assert.equal(res.redirectPath, null);
+      }
+    });
+
+    it("exports search results as typed arrays", () => {
+      const archive = new Archive(outFile);
+      const search = new Searcher(archive).search(testText);
+      const columns = search.getResultsColumnar(0, 100);
+      const results = Array.from(search.getResults(0, 100));
+
+      assert.equal(columns.entryIndexes.length, items.length);
+      assert.deepEqual(columns.zimIds, [archive.uuid]);
+      results.forEach((res, i) => {
+        assert.equal(
+          archive.getEntryByPath(columns.entryIndexes[i]).path,
+          res.path,
+        );
+        assert.equal(columns.scores[i], res.score);
+        assert.equal(columns.fileIndexes[i], res.fileIndex);
+      });
+
+      // every archive has its id, even without a hit in the page
+      const federated = new Searcher([archive, new Archive(outFile)])
+        .search(testText)
+        .getResultsColumnar(0, 1);
+      assert.equal(federated.entryIndexes.length, 1);
+      assert.deepEqual(federated.zimIds, [archive.uuid, archive.uuid]);
+    });
+
+    it("pages through results with a cursor", async () => {
+      const search = new Searcher(new Archive(outFile)).search(testText);
+      const cursor = search.cursor({ pageSize: 3 });
+      assert.equal(cursor.pageSize, 3);
+
+      const paths: string[] = [];
+      for await (const page of cursor) {
+        assert.equal(page.size <= 3, true);
+        paths.push(...Array.from(page).map((res) => res.path));
+      }
+      assert.deepEqual(
+        paths,
+        Array.from(search.getResults(0, 100)).map((res) => res.path),
+      );
+      assert.equal((await cursor.next()).done, true);
+      assert.throws(() => search.cursor({ pageSize: 0 }));
+
+      // next() calls racing the prefetches still get the pages in order
+      const racing = search.cursor({ pageSize: 1 });
+      const pages = await Promise.all(items.map(() => racing.next()));
+      assert.deepEqual(
+        pages.flatMap((res) =>
+          res.value ? Array.from(res.value, (hit) => hit.path) : [],
+        ),
+        paths,
+      );
+    });
+
+    it("cancels the pages of a cursor", async () => {
+      const search = new Searcher(new Archive(outFile)).search(testText);
+      await assert.rejects(
+        search.cursor({ pageSize: 1, timeoutMs: 0 }).next(),
+        { name: "TimeoutError" },
+      );
+
+      const controller = new AbortController();
+      const cursor = search.cursor({ pageSize: 1, signal: controller.signal });
+      assert.equal((await cursor.next()).done, false);
+      controller.abort();
+      await assert.rejects(cursor.next(), { name: "AbortError" });
+      assert.throws(() => search.cursor({ timeoutMs: -1 }), TypeError);
+    });
+
+    it("searches the archive asynchronously", async () => {
+      const searcher = new Searcher(new Archive(outFile));
+      const [first, second] = await Promise.all([
+        searcher.searchAsync(testText, { start: 0, maxResults: 3 }),
+        searcher.searchAsync(new Query(testText), { start: 3 }),
+      ]);
+      assert.equal(first.size, 3);
+      assert.equal(second.size, items.length - 3);
+      for (const options of [{ start: -1 }, { maxResults: Number.NaN }]) {
+        assert.throws(
+          () => searcher.searchAsync(testText, options),
+          RangeError,
+        );
+      }
+
+      const paths = [...first, ...second].map((res) => res.path).sort();
+      assert.deepEqual(
+        paths,
+        items.map((item) => item.path),
+      );
+
+      // hits read on the main thread match the sync search
+      const withSnippets = await searcher.searchAsync(testText, {
+        maxResults: 3,
+        snippets: true,
+      });
+      const sync = Array.from(searcher.search(testText).getResults(0, 3));
+      assert.deepEqual(
+        Array.from(withSnippets, ({ path, title, snippet }) => ({
+          path,
+          title,
+          snippet,
+        })),
+        sync.map(({ path, title, snippet }) => ({ path, title, snippet })),
+      );
+
+      // snippets come with async pages unless turned off
+      const [eager, late] = await Promise.all([
+        searcher.searchAsync(testText, { maxResults: 3 }),
+        searcher.searchAsync(testText, { maxResults: 3, snippets: false }),
+      ]);
+      assert.deepEqual(
+        Array.from(late, (res) => res.snippet),
+        Array.from(eager, (res) => res.snippet),
+      );
+    });
+
+    it("rejects searches past their deadline or aborted", async () => {
+      const searcher = new Searcher(new Archive(outFile));
+      await assert.rejects(searcher.searchAsync(testText, { timeoutMs: 0 }), {
+        name: "TimeoutError",
+        code: "ETIMEDOUT",
+      });
+      await assert.rejects(
+        searcher.searchMany([{ query: testText }], { timeoutMs: 0 }),
+        { name: "TimeoutError" },
+      );
+
+      const aborted = new AbortController();
+      aborted.abort();
+      await assert.rejects(
+        searcher.searchAsync(testText, { signal: aborted.signal }),
+        { name: "AbortError" },
+      );
+
+      const controller = new AbortController();
+      const pending = searcher.searchAsync(testText, {
+        signal: controller.signal,
+      });
+      controller.abort();
+      await assert.rejects(pending, { name: "AbortError" });
+
+      const results = await searcher.searchAsync(testText, {
+        timeoutMs: 60000,
+        signal: new AbortController().signal,
+      });
+      assert.equal(results.size, items.length);
+    });
+
+    it("runs many searches in parallel", async () => {
+      const searcher = new Searcher(new Archive(outFile));
+      const pages = await searcher.searchMany([
+        { query: testText },
+        { query: new Query(testText), start: 1, max: 2 },
+        { query: "nothingmatchesthis" },
+      ]);
+      assert.deepEqual(
+        pages.map((page) => page.size),
+        [items.length, 2, 0],
+      );
+      assert.deepEqual(await searcher.searchMany([]), []);
+      assert.throws(
+        () => searcher.searchMany([{ query: testText, max: -1 }]),
+        RangeError,
+      );
+    });
+
+    it("merges the top hits of every archive", async () => {
+      const archive = new Archive(outFile);
+      const searcher = new Searcher([archive, new Archive(outFile)]);
+
+      const hits = await searcher.searchFederated(testText, {
+        k: 3,
+        weights: [1, 2],
+      });
+      assert.equal(hits.length, 3);
+      for (const hit of hits) {
+        // the heavier archive wins every tie
+        assert.equal(hit.fileIndex, 1);
+        assert.equal(hit.zimId, archive.uuid);
+        assert.equal(hit.weightedScore, hit.score * 2);
+        assert.equal(hit.snippet, undefined);
+      }
+
+      const all = await searcher.searchFederated(testText, {
+        k: 100,
+        snippets: true,
+      });
+      assert.equal(all.length, items.length * 2);
+      assert.equal(typeof all[0].snippet, "string");
+      for (const k of [0, -1, Number.POSITIVE_INFINITY]) {
+        assert.throws(
+          () => searcher.searchFederated(testText, { k }),
+          RangeError,
+        );
+      }
+      for (const weights of [[1, -1], [Number.NaN, 1], [1]]) {
+        assert.throws(
+          () => searcher.searchFederated(testText, { weights }),
+          RangeError,
+        );
+      }
+    });
+
+    it("counts estimated matches", async () => {
+      const searcher = new Searcher(new Archive(outFile));
+      const queries = [testText, new Query("binding"), "nothingmatchesthis"];
+      assert.deepEqual(searcher.countEstimated(queries), [
+        items.length,
+        items.length,
+        0,
+      ]);
+      assert.deepEqual(
+        await searcher.countEstimated(queries, { async: true }),
+        searcher.countEstimated(queries),
+      );
+    });
+
+    it("caches search result pages", async () => {
+      const searcher = new Searcher(new Archive(outFile));
+      await searcher.searchAsync(testText);
+      assert.equal(searcher.getResultCacheStats().entries, 0);
+
+      assert.throws(
+        () => searcher.setResultCache({ maxEntries: -1 }),
+        RangeError,
+      );
+      searcher.setResultCache({ maxEntries: 2 });
+      const first = await searcher.searchAsync(testText);
+      const second = await searcher.searchAsync(`  ${testText}  `);
+      assert.deepEqual(
+        Array.from(second).map((res) => res.path),
+        Array.from(first).map((res) => res.path),
+      );
+      let stats = searcher.getResultCacheStats();
+      assert.equal(stats.entries, 1);
+      assert.equal(stats.hits, 1);
+      assert.equal(stats.hitRate, 0.5);
+
+      const aborted = new AbortController();
+      aborted.abort();
+      await assert.rejects(
+        searcher.searchAsync(testText, { signal: aborted.signal }),
+        { name: "AbortError" },
+      );
+      await assert.rejects(searcher.searchAsync(testText, { timeoutMs: 0 }), {
+        name: "TimeoutError",
+      });
+
+      await searcher.searchAsync(testText, { start: 1 });
+      await searcher.searchAsync(testText, { start: 2 });
+      stats = searcher.getResultCacheStats();
+      assert.equal(stats.entries, 2);
+      assert.equal(stats.evictions, 1);
+
+      searcher.addArchive(new Archive(outFile));
+      assert.equal(searcher.getResultCacheStats().entries, 0);
+      searcher.setResultCache(false);
+    });
+
+    it("spreads searches over a searcher pool", async () => {
+      const pool = new SearcherPool(new Archive(outFile), { size: 2 });
+      assert.equal(pool.size, 2);
+      assert.throws(() => new SearcherPool(new Archive(outFile), { size: 0 }));
+
+      const all = await Promise.all(
+        Array.from(Array(8).keys()).map(() =>
+          pool.searchAsync(testText, { maxResults: 100 }),
+        ),
+      );
+      for (const results of all) {
+        assert.equal(results.size, items.length);
+      }
+
+      const stats = pool.getStats();
+      assert.equal(stats.submitted, 8);
+      assert.equal(stats.completed, 8);
+      assert.equal(stats.busy, 0);
+      assert.equal(stats.waiting, 0);
+      assert.equal(stats.saturation, 0);
+      assert.equal(stats.maxLatencyMs >= stats.avgLatencyMs, true);
+    });
+
+    it("searches a preloaded Xapian database from every thread", async () => {
+      // every searcher over this archive shares its opened database
+      const archive = new Archive(
+        outFile,
+        new OpenConfig().preloadXapianDb(true),
+      );
+      const searcher = new Searcher(archive);
+      const pool = new SearcherPool(archive, { size: 4 });
+      const preload = archive.preloadFulltextIndex({ async: true });
+      const many = searcher.searchMany(
+        Array.from(Array(8).keys(), () => ({ query: testText, max: 100 })),
+      );
+      const pages = Promise.all([
+        ...Array.from(Array(8).keys(), () =>
+          pool.searchAsync(testText, { maxResults: 100 }),
+        ),
+        ...Array.from(Array(8).keys(), () =>
+          searcher.searchAsync(testText, { maxResults: 100 }),
+        ),
+      ]);
+      const cursorPage = searcher
+        .search(testText)
+        .cursor({ pageSize: 100 })
+        .next();
+      for (let i = 0; i < 8; i++) {
+        assert.equal(
+          searcher.search(testText).getResults(0, 100).size,
+          items.length,
+        );
+      }
+
+      assert.equal((await preload).opened, true);
+      for (const page of [...(await many), ...(await pages)]) {
+        assert.equal(page.size, items.length);
+      }
+      assert.equal((await cursorPage).value?.size, items.length);
+    });
   });
 
   describe("Suggestion Search", () => {
@@ -666,6 +1305,145 @@ describe("Archive", () => {
         assert.match(item.title, new RegExp(`^${testText} \\d+\$`));
       }
     });
+
+    it("autocompletes prefixes from a top-k index", async () => {
+      const archive = new Archive(outFile);
+      const popularity = "./test-popularity.tsv";
+      const sidecar = "./test-autocomplete.idx";
+      const damaged = "./test-autocomplete-damaged.idx";
+      fs.writeFileSync(popularity, "test3\t100\ntest1\t50\n");
+      try {
+        const index = await AutocompleteIndex.build(archive, {
+          topK: 3,
+          popularityFile: popularity,
+        });
+        assert.equal(index.topK, 3);
+        assert.equal(index.mapped, false);
+        const completions = index.complete("OP");
+        assert.deepEqual(
+          completions.map(({ path }) => path),
+          ["test3", "test1", "test0"],
+        );
+        assert.equal(index.complete("op", { max: 1 }).length, 1);
+        assert.deepEqual(index.complete("xyz"), []);
+        assert.equal(index.complete(testText).length, 3);
+        // past maxPrefixLength, still case insensitive
+        assert.deepEqual(
+          index.complete(`${testText.toUpperCase()} 4`).map(({ path }) => path),
+          ["test4"],
+        );
+        assert.deepEqual(
+          index.complete("OpenZIM binding 3").map(({ path }) => path),
+          ["test3"],
+        );
+
+        await index.save(sidecar);
+        const loaded = AutocompleteIndex.load(archive, sidecar);
+        assert.equal(loaded.mapped, true);
+        assert.equal(loaded.nodeCount, index.nodeCount);
+        assert.deepEqual(loaded.complete("OP"), completions);
+
+        // corrupted sidecars are rejected, not read out of bounds
+        const header = 56;
+        const corrupt = (patch: (bytes: Buffer) => void) => {
+          const bytes = fs.readFileSync(sidecar);
+          patch(bytes);
+          fs.writeFileSync(damaged, bytes);
+          return () => AutocompleteIndex.load(archive, damaged);
+        };
+        // keysBytes wrapping the size sum around
+        assert.throws(
+          corrupt((bytes) => bytes.writeBigUInt64LE(2n ** 64n - 1n, 24)),
+          /Truncated/,
+        );
+        // first node's key past the keys
+        assert.throws(
+          corrupt((bytes) => bytes.writeUInt32LE(0xffffffff, header)),
+          /Corrupt/,
+        );
+        // first node's entries past the entries
+        assert.throws(
+          corrupt((bytes) => bytes.writeUInt32LE(0xffffffff, header + 12)),
+          /Corrupt/,
+        );
+        // first two nodes swapped
+        assert.throws(
+          corrupt((bytes) => {
+            const first = Buffer.from(bytes.subarray(header, header + 16));
+            bytes.copy(bytes, header, header + 16, header + 32);
+            first.copy(bytes, header + 16);
+          }),
+          /Corrupt/,
+        );
+      } finally {
+        fs.rmSync(popularity, { force: true });
+        fs.rmSync(sidecar, { force: true });
+        fs.rmSync(damaged, { force: true });
+      }
+    });
+
+    it("suggests titles with typos", async () => {
+      const index = await FuzzyTitleIndex.build(new Archive(outFile));
+      assert(index.size >= items.length);
+      assert(index.memoryBytes > 0);
+
+      const [best] = index.suggest("opnezim bindign 3");
+      assert.deepEqual(
+        { path: best.path, distance: best.distance },
+        { path: "test3", distance: 2 },
+      );
+      assert.deepEqual(
+        index.suggest("opnezim bindign 3", { maxDistance: 1 }),
+        [],
+      );
+      assert.equal(
+        index.suggest("OPENZIM BINDNG", { prefix: true, max: 100 }).length,
+        items.length,
+      );
+      assert.deepEqual(index.suggest("xpenzim binding 3"), []);
+      assert.equal(
+        index.suggest("xpenzim binding 3", { fixedPrefix: 0 })[0].path,
+        "test3",
+      );
+      assert.deepEqual(
+        await index.suggest("opnezim bindign 3", { async: true }),
+        index.suggest("opnezim bindign 3"),
+      );
+    });
+
+    it("suggests asynchronously from a prefix cache", async () => {
+      const suggestionSearcher = new SuggestionSearcher(new Archive(outFile));
+      const expected = Array.from(
+        suggestionSearcher.suggest(testText).getResults(0, 3),
+      ).map(({ title, path }) => ({ title, path }));
+
+      const first = await suggestionSearcher.suggestAsync(testText, {
+        max: 3,
+      });
+      assert.deepEqual(first, expected);
+      const again = await suggestionSearcher.suggestAsync(
+        `  ${testText.toUpperCase()}`,
+        { max: 3 },
+      );
+      assert.deepEqual(again, expected);
+      const stats = suggestionSearcher.getResultCacheStats();
+      assert.equal(stats.hits, 1);
+      assert.equal(stats.entries, 1);
+
+      const withSnippets = await suggestionSearcher.suggestAsync(testText, {
+        snippets: true,
+      });
+      assert.equal(withSnippets.length, items.length);
+      await assert.rejects(
+        suggestionSearcher.suggestAsync(testText, { timeoutMs: 0 }),
+        { name: "TimeoutError" },
+      );
+      // cached pages still honour the deadline
+      await assert.rejects(
+        suggestionSearcher.suggestAsync(testText, { max: 3, timeoutMs: 0 }),
+        { name: "TimeoutError" },
+      );
+    });
   });
 
   describe("Cache sizes", () => {